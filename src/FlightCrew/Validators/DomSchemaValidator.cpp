@@ -24,11 +24,27 @@
 #include "Misc/ErrorResultCollector.h"
 #include <ToXercesStringConverter.h>
 #include <LocationAwareDOMParser.h>
+#include <ParserPool.h>
+#include <XercesStatic.h>
 #include <xercesc/sax/SAXException.hpp>
 #include "Misc/Utilities.h"
 
 namespace FlightCrew
 {
+
+typedef xe::ParserPool< xe::LocationAwareDOMParser > DomParserPool;
+typedef boost::unordered_map< std::string, boost::shared_ptr< DomParserPool > > DomParserPools;
+
+static DomParserPools* CreateParserPools()
+{
+    return new DomParserPools();
+}
+
+// The compiled schemas and the parsers using them are kept around
+// for all the files validated against the same external schema location.
+static xe::XercesStatic< DomParserPools > s_ParserPools( CreateParserPools );
+static boost::mutex s_ParserPoolsMutex;
+
     
 std::vector< Result > DomSchemaValidator::ValidateAgainstSchema(
     const fs::path &filepath,
@@ -36,24 +52,15 @@ std::vector< Result > DomSchemaValidator::ValidateAgainstSchema(
     const std::vector< const xc::MemBufInputSource* > &schemas,
     const std::vector< const xc::MemBufInputSource* > &dtds )
 {
-    xe::LocationAwareDOMParser parser;
-
-    parser.setDoSchema(             true  );
-    parser.setLoadSchema(           false );
-    parser.setSkipDTDValidation(    true  );
-    parser.setDoNamespaces(         true  );
-    parser.useCachedGrammarInParse( true  );  
-
-    parser.setValidationScheme( xc::AbstractDOMParser::Val_Always ); 
-
-    LoadSchemas( parser, external_schema_location, schemas, dtds );
+    boost::shared_ptr< xe::LocationAwareDOMParser > parser = 
+        GetParserPool( external_schema_location, schemas, dtds ).GetParser();
 
     ErrorResultCollector collector;
-    parser.setErrorHandler( &collector ); 
+    parser->setErrorHandler( &collector ); 
 
     try
     {
-        parser.parse( toX( Util::BoostPathToUtf8Path( filepath ) ) );
+        parser->parse( toX( Util::BoostPathToUtf8Path( filepath ) ) );
     }
 
     catch ( xc::SAXException& exception )
@@ -70,23 +77,46 @@ std::vector< Result > DomSchemaValidator::ValidateAgainstSchema(
 }
 
 
-void DomSchemaValidator::LoadSchemas( 
-    xe::LocationAwareDOMParser &parser,
+xe::ParserPool< xe::LocationAwareDOMParser >& DomSchemaValidator::GetParserPool( 
     const std::string &external_schema_location,
     const std::vector< const xc::MemBufInputSource* > &schemas,
     const std::vector< const xc::MemBufInputSource* > &dtds )
 {
-    foreach( const xc::MemBufInputSource *input, dtds )
-    {
-        parser.loadGrammar( *input, xc::Grammar::DTDGrammarType,    true );   
-    }
+    boost::lock_guard< boost::mutex > locker( s_ParserPoolsMutex );
+
+    DomParserPools &pools = s_ParserPools.Get();
+    boost::shared_ptr< DomParserPool > &pool = pools[ external_schema_location ];
 
-    foreach( const xc::MemBufInputSource *input, schemas )
+    if ( !pool )
     {
-        parser.loadGrammar( *input, xc::Grammar::SchemaGrammarType, true );  
+        pool.reset( new DomParserPool( 
+            std::vector< const xc::InputSource* >( dtds.begin(), dtds.end() ),
+            std::vector< const xc::InputSource* >( schemas.begin(), schemas.end() ),
+            boost::bind( &DomSchemaValidator::CreateParser, _1, external_schema_location ) ) );
     }
 
-    parser.setExternalSchemaLocation( external_schema_location.c_str() );
+    return *pool;
+}
+
+
+xe::LocationAwareDOMParser* DomSchemaValidator::CreateParser( 
+    xc::XMLGrammarPool &grammar_pool,
+    const std::string &external_schema_location )
+{
+    xe::LocationAwareDOMParser *parser = 
+        new xe::LocationAwareDOMParser( 0, xc::XMLPlatformUtils::fgMemoryManager, &grammar_pool );
+
+    parser->setDoSchema(             true  );
+    parser->setLoadSchema(           false );
+    parser->setSkipDTDValidation(    true  );
+    parser->setDoNamespaces(         true  );
+    parser->useCachedGrammarInParse( true  );  
+
+    parser->setValidationScheme( xc::AbstractDOMParser::Val_Always ); 
+
+    parser->setExternalSchemaLocation( external_schema_location.c_str() );
+
+    return parser;
 }
 
 } //namespace FlightCrew
@@ -24,9 +24,9 @@
 #define DOMSCHEMAVALIDATOR_H
 
 #include <xercesc/framework/MemBufInputSource.hpp>
-namespace XERCES_CPP_NAMESPACE { class MemBufInputSource; };
+namespace XERCES_CPP_NAMESPACE { class MemBufInputSource; class XMLGrammarPool; };
 namespace xc = XERCES_CPP_NAMESPACE;
-namespace XercesExt { class LocationAwareDOMParser; }
+namespace XercesExt { class LocationAwareDOMParser; template< class Parser > class ParserPool; }
 namespace xe = XercesExt;
 #include "IValidator.h"
 
@@ -46,11 +46,19 @@ protected:
 
 private:
 
-    void LoadSchemas( 
-        xe::LocationAwareDOMParser &parser,
+    /**
+     * Returns the pool of parsers for the given schema set.
+     * The schemas are only compiled the first time a set is seen;
+     * the external schema location is used as the key of the set.
+     */
+    static xe::ParserPool< xe::LocationAwareDOMParser >& GetParserPool( 
         const std::string &external_schema_location,
         const std::vector< const xc::MemBufInputSource* > &schemas,
         const std::vector< const xc::MemBufInputSource* > &dtds );
+
+    static xe::LocationAwareDOMParser* CreateParser( 
+        xc::XMLGrammarPool &grammar_pool,
+        const std::string &external_schema_location );
 };
 
 } // namespace FlightCrew
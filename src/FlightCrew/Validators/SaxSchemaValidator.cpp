@@ -25,28 +25,34 @@
 #include <ToXercesStringConverter.h>
 #include <xercesc/sax2/SAX2XMLReader.hpp>
 #include <xercesc/sax2/XMLReaderFactory.hpp>
+#include <ParserPool.h>
+#include <XercesStatic.h>
 #include "Misc/Utilities.h"
 
 namespace FlightCrew
 {
+
+typedef xe::ParserPool< xc::SAX2XMLReader > SaxParserPool;
+typedef boost::unordered_map< std::string, boost::shared_ptr< SaxParserPool > > SaxParserPools;
+
+static SaxParserPools* CreateParserPools()
+{
+    return new SaxParserPools();
+}
+
+// The compiled schemas and the parsers using them are kept around
+// for all the files validated against the same external schema location.
+static xe::XercesStatic< SaxParserPools > s_ParserPools( CreateParserPools );
+static boost::mutex s_ParserPoolsMutex;
+
     
 std::vector< Result > SaxSchemaValidator::ValidateAgainstSchema(
     const fs::path &filepath,
     const std::string &external_schema_location,
     const std::vector< const xc::MemBufInputSource* > &schemas )
 {
-    boost::scoped_ptr< xc::SAX2XMLReader > parser( xc::XMLReaderFactory::createXMLReader() );
-
-    parser->setFeature( xc::XMLUni::fgSAX2CoreValidation,            true  );
-    parser->setFeature( xc::XMLUni::fgXercesLoadSchema,              false );
-    parser->setFeature( xc::XMLUni::fgXercesUseCachedGrammarInParse, true  );
-    parser->setFeature( xc::XMLUni::fgXercesSkipDTDValidation,       true  );
-
-    // We don't need DTD validation
-    parser->setProperty( xc::XMLUni::fgXercesScannerName, 
-                         (void*) xc::XMLUni::fgSGXMLScanner );    
-
-    LoadSchemas( *parser, external_schema_location, schemas );
+    boost::shared_ptr< xc::SAX2XMLReader > parser = 
+        GetParserPool( external_schema_location, schemas ).GetParser();
 
     ErrorResultCollector collector;
     parser->setErrorHandler( &collector );
@@ -70,19 +76,47 @@ std::vector< Result > SaxSchemaValidator::ValidateAgainstSchema(
 }
 
 
-void SaxSchemaValidator::LoadSchemas( 
-    xc::SAX2XMLReader &parser,
+xe::ParserPool< xc::SAX2XMLReader >& SaxSchemaValidator::GetParserPool( 
     const std::string &external_schema_location,
     const std::vector< const xc::MemBufInputSource* > &schemas )
 {
-   
-    foreach( const xc::MemBufInputSource *input, schemas )
+    boost::lock_guard< boost::mutex > locker( s_ParserPoolsMutex );
+
+    SaxParserPools &pools = s_ParserPools.Get();
+    boost::shared_ptr< SaxParserPool > &pool = pools[ external_schema_location ];
+
+    if ( !pool )
     {
-        parser.loadGrammar( *input, xc::Grammar::SchemaGrammarType, true );  
+        pool.reset( new SaxParserPool( 
+            std::vector< const xc::InputSource* >(),
+            std::vector< const xc::InputSource* >( schemas.begin(), schemas.end() ),
+            boost::bind( &SaxSchemaValidator::CreateParser, _1, external_schema_location ) ) );
     }
 
-    parser.setProperty( xc::XMLUni::fgXercesSchemaExternalSchemaLocation, 
-                        (void*) toX( external_schema_location ) );
+    return *pool;
+}
+
+
+xc::SAX2XMLReader* SaxSchemaValidator::CreateParser( 
+    xc::XMLGrammarPool &grammar_pool,
+    const std::string &external_schema_location )
+{
+    xc::SAX2XMLReader *parser = 
+        xc::XMLReaderFactory::createXMLReader( xc::XMLPlatformUtils::fgMemoryManager, &grammar_pool );
+
+    parser->setFeature( xc::XMLUni::fgSAX2CoreValidation,            true  );
+    parser->setFeature( xc::XMLUni::fgXercesLoadSchema,              false );
+    parser->setFeature( xc::XMLUni::fgXercesUseCachedGrammarInParse, true  );
+    parser->setFeature( xc::XMLUni::fgXercesSkipDTDValidation,       true  );
+
+    // We don't need DTD validation
+    parser->setProperty( xc::XMLUni::fgXercesScannerName, 
+                         (void*) xc::XMLUni::fgSGXMLScanner );    
+
+    parser->setProperty( xc::XMLUni::fgXercesSchemaExternalSchemaLocation, 
+                         (void*) toX( external_schema_location ) );
+
+    return parser;
 }
 
 } //namespace FlightCrew
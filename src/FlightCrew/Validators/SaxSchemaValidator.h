@@ -24,8 +24,10 @@
 #define SAXSCHEMAVALIDATOR_H
 
 #include <xercesc/framework/MemBufInputSource.hpp>
-namespace XERCES_CPP_NAMESPACE { class SAX2XMLReader; class MemBufInputSource; };
+namespace XERCES_CPP_NAMESPACE { class SAX2XMLReader; class MemBufInputSource; class XMLGrammarPool; };
 namespace xc = XERCES_CPP_NAMESPACE;
+namespace XercesExt { template< class Parser > class ParserPool; }
+namespace xe = XercesExt;
 #include "IValidator.h"
 
 namespace FlightCrew
@@ -43,9 +45,18 @@ protected:
 
 private:
 
-    void LoadSchemas( xc::SAX2XMLReader &parser,
-                      const std::string &external_schema_location,
-                      const std::vector< const xc::MemBufInputSource* > &schemas );
+    /**
+     * Returns the pool of parsers for the given schema set.
+     * The schemas are only compiled the first time a set is seen;
+     * the external schema location is used as the key of the set.
+     */
+    static xe::ParserPool< xc::SAX2XMLReader >& GetParserPool( 
+        const std::string &external_schema_location,
+        const std::vector< const xc::MemBufInputSource* > &schemas );
+
+    static xc::SAX2XMLReader* CreateParser( 
+        xc::XMLGrammarPool &grammar_pool,
+        const std::string &external_schema_location );
 };
 
 } // namespace FlightCrew
@@ -24,12 +24,14 @@
 #include <QtCore/QtCore>
 #include <QtCore/QFileInfo>
 #include <QtCore/QFutureSynchronizer>
+#include <QtGui/QProgressDialog>
 
 #include "BookManipulation/Book.h"
 #include "BookManipulation/CleanSource.h"
 #include "BookManipulation/FolderKeeper.h"
 #include "BookManipulation/XercesCppUse.h"
 #include "BookManipulation/XhtmlDoc.h"
+#include "Misc/FutureCollector.h"
 #include "Misc/TempFolder.h"
 #include "Misc/Utility.h"
 #include "Misc/HTMLSpellCheck.h"
@@ -69,7 +71,8 @@ static const QString EMPTY_HTML_FILE  = "<?xml version=\"1.0\" encoding=\"utf-8\
 Book::Book()
     : 
     m_Mainfolder( *new FolderKeeper( this ) ),
-    m_IsModified( false )
+    m_IsModified( false ),
+    m_LastSaveWriteCount( 0 )
 {
    
 }
@@ -247,7 +250,7 @@ HTMLResource& Book::CreateChapterBreakOriginalResource( const QString &content,
     HTMLResource &new_resource = CreateNewHTMLFile();
     new_resource.RenameTo( originating_filename );
 
-    new_resource.SetText( CleanSource::Clean( content ) );
+    new_resource.SetText( content );
 
 
     new_resource.SaveToDisk();
@@ -282,109 +285,150 @@ HTMLResource& Book::CreateChapterBreakOriginalResource( const QString &content,
 
 void Book::CreateNewChapters( const QStringList &new_chapters, HTMLResource &original_resource )
 {
-    int original_position = GetOPF().GetReadingOrder( original_resource );
-    Q_ASSERT( original_position >= 0 );
+    if ( new_chapters.isEmpty() )
+
+        return;
 
-    QString new_file_prefix = QFileInfo( original_resource.Filename() ).baseName();
+    QHash< HTMLResource*, QStringList > chapters;
+    chapters[ &original_resource ] = new_chapters;
 
+    CreateNewChapters( chapters );
+}
+
+
+void Book::CreateNewChapters( const QHash< HTMLResource*, QStringList > &new_chapters )
+{
     if ( new_chapters.isEmpty() )
 
         return;
 
-    TempFolder tempfolder;
+    QList< HTMLResource* > html_resources = m_Mainfolder.GetResourceTypeList< HTMLResource >( true );
 
+    // The new chapters of all the files are created in parallel.
+    // They don't go into the OPF yet, so it's only updated once.
     QFutureSynchronizer< NewChapterResult > sync;
-    QList< HTMLResource* > html_resources = m_Mainfolder.GetResourceTypeList< HTMLResource >( true );
 
-    // A list of all the files that have not been involved in the split.
-    // This will be used later when anchors are updated.
-    QList< HTMLResource* > other_files = html_resources;
-    other_files.removeOne( &original_resource );
+    foreach( HTMLResource *html_resource, html_resources )
+    {
+        if ( !new_chapters.contains( html_resource ) )
 
-    int next_reading_order;
-    if ( original_position == -1 )
+            continue;
 
-        next_reading_order = m_Mainfolder.GetHighestReadingOrder() + 1;
+        const QStringList &chapters = new_chapters.value( html_resource );
+        QString new_file_prefix = QFileInfo( html_resource->Filename() ).baseName();
 
-    else
+        for ( int i = 0; i < chapters.count(); ++i )
+        {
+            NewChapter chapterInfo;
+            chapterInfo.source = chapters.at( i );
+            chapterInfo.reading_order = i;
+            chapterInfo.new_file_prefix = new_file_prefix;
+            chapterInfo.file_suffix = i + 1;
+
+            sync.addFuture( 
+                QtConcurrent::run( 
+                    this, 
+                    &Book::CreateOneNewChapter, 
+                    chapterInfo ) );
+        }
+    }
+
+    sync.waitForFinished();
+
+    QList< QFuture< NewChapterResult > > futures = sync.futures();
+    QList< Resource* > created_chapters;
+    QList< HTMLResource* > reading_order;
+    QHash< QString, QList< HTMLResource* > > new_files_by_originating_filename;
 
-        next_reading_order = original_position + 1;
+    int next_future = 0;
 
-    for ( int i = 0; i < new_chapters.count(); ++i )
+    // The futures are in the order they were added: the chapters 
+    // of each split file, in the reading order of the split files.
+    foreach( HTMLResource *html_resource, html_resources )
     {
-        int reading_order = next_reading_order + i;
-
-        NewChapter chapterInfo;
-        chapterInfo.source = new_chapters.at( i );
-        chapterInfo.reading_order = reading_order;
-        chapterInfo.temp_folder_path = tempfolder.GetPath();
-        chapterInfo.new_file_prefix = new_file_prefix;
-        chapterInfo.file_suffix = i + 1;
-
-        sync.addFuture( 
-            QtConcurrent::run( 
-                this, 
-                &Book::CreateOneNewChapter, 
-                chapterInfo ) );
-    }	
+        reading_order.append( html_resource );
 
-    sync.waitForFinished();
+        if ( !new_chapters.contains( html_resource ) )
 
-    QList< HTMLResource* > new_files;
-    new_files.append( &original_resource );
+            continue;
 
-    QList< QFuture< NewChapterResult > > futures = sync.futures();
-    if ( original_position == -1 )
-    {
-        // Add new chapters to the end of the book
-        for ( int i = 0; i < futures.count(); ++i )
+        QList< HTMLResource* > new_files;
+        new_files.append( html_resource );
+
+        int chapter_count = new_chapters.value( html_resource ).count();
+
+        for ( int i = 0; i < chapter_count; ++i )
         {
-            html_resources.append( futures.at( i ).result().created_chapter );
-            new_files.append( futures.at( i ).result().created_chapter );
+            HTMLResource *created_chapter = futures.at( next_future++ ).result().created_chapter;
+
+            created_chapters.append( created_chapter );
+            reading_order.append( created_chapter );
+            new_files.append( created_chapter );
         }
+
+        new_files_by_originating_filename[ Utility::URLEncodePath( html_resource->Filename() ) ] = new_files;
     }
-    else
+
+    GetOPF().AddResources( created_chapters );
+    GetOPF().UpdateSpineOrder( reading_order );
+
+    // All the anchors are updated in one pass over the book. Within the files that came from one
+    // split file it's safe to assume that the fragment ids are all unique (since otherwise the
+    // references would be broken); links from other files are matched by the split file's name.
+    const QHash< QString, QHash< QString, QString > > &ID_locations = 
+        AnchorUpdates::GetIDLocationsAfterSplits( new_files_by_originating_filename );
+
+    AnchorUpdates::UpdateAnchorsAfterSplits( m_Mainfolder.GetResourceTypeList< HTMLResource >( false ), 
+                                             new_files_by_originating_filename, 
+                                             ID_locations );
+
+    // Update TOC entries as well
+    AnchorUpdates::UpdateTOCEntriesAfterSplits( &GetNCX(), ID_locations );
+
+    SetModified( true );
+}
+
+
+QList< HTMLResource* > Book::SplitOnSGFChapterMarkers( const QList< HTMLResource* > &html_resources )
+{
+    const QList< QStringList > &all_chapters = 
+        QtConcurrent::blockingMapped( html_resources, SplitOneFileOnSGFChapterMarkers );
+
+    QHash< HTMLResource*, QStringList > new_chapters;
+    QList< HTMLResource* > split_resources;
+
+    for ( int i = 0; i < html_resources.count(); ++i )
     {
-        // Insert the new files at the correct positions in the list
-        // The new files need to be inserted in order from first to last
-        for ( int i = 0; i < new_chapters.count(); ++i )
+        QStringList chapters = all_chapters.at( i );
+
+        if ( chapters.count() < 2 )
+
+            continue;
+
+        HTMLResource *html_resource = html_resources.at( i );
+
+        // The text is set here and not in the workers because
+        // setting it notifies the views, which live on this thread
         {
-            int reading_order = next_reading_order + i;
-            if( futures.at(i).result().reading_order == reading_order )
-            {
-                html_resources.insert( reading_order , futures.at( i ).result().created_chapter );
-                new_files.append( futures.at( i ).result().created_chapter );
-            }
-            else
-            {
-                // This is security code to protect against any mangling of the futures list by Qt
-                for( int j = 0 ; j < futures.count() ; ++j )
-                {
-                    if( futures.at(j).result().reading_order == reading_order )
-                    {
-                        html_resources.insert( reading_order , futures.at( j ).result().created_chapter );
-                        new_files.append( futures.at( j ).result().created_chapter );
-                        break;
-                    }
-                }
-            }
+            QWriteLocker locker( &html_resource->GetLock() );
+            html_resource->SetText( chapters.takeFirst() );
         }
+
+        new_chapters[ html_resource ] = chapters;
+        split_resources.append( html_resource );
     }
 
-    // Update anchor references between fragment ids in the new files. Since these all came from one single
-    // file it's safe to assume that the fragment ids are all unique (since otherwise the references would be broken).
-    AnchorUpdates::UpdateAllAnchorsWithIDs( new_files );
+    CreateNewChapters( new_chapters );
 
-    // Now, update references to the original file that are made in other files.
-    // We can't assume that ids are unique in this case, and so need to use a different mechanism.
-    AnchorUpdates::UpdateExternalAnchors( other_files, Utility::URLEncodePath( original_resource.Filename() ), new_files );
+    return split_resources;
+}
 
-    // Update TOC entries as well
-    AnchorUpdates::UpdateTOCEntries(&GetNCX(), Utility::URLEncodePath(original_resource.Filename()), new_files);
 
-    GetOPF().UpdateSpineOrder( html_resources ); 
+QStringList Book::SplitOneFileOnSGFChapterMarkers( HTMLResource *html_resource )
+{
+    QReadLocker locker( &html_resource->GetLock() );
 
-    SetModified( true );
+    return XhtmlDoc::GetSGFChapterSplits( html_resource->GetText() );
 }
 
 
@@ -429,68 +473,39 @@ QHash<QString, QStringList> Book::GetIdsInHTMLFiles()
 {
     QHash<QString, QStringList> ids_in_html;
 
-    const QList<HTMLResource*> html_resources = m_Mainfolder.GetResourceTypeList< HTMLResource >(false);
-
-    QFuture< boost::tuple<QString, QStringList> > future = QtConcurrent::mapped(html_resources, GetIdsInHTMLFileMapped);
-
-    for (int i = 0; i < future.results().count(); i++) {
-        QString filename;
-        QStringList ids;
-        tie(filename, ids) = future.resultAt(i);
-
-        // Each target entry has a list of filenames that contain it
-        ids_in_html[filename] = ids;
+    foreach (const HTMLSummary &summary, GetHTMLSummaries()) {
+        ids_in_html[summary.filename] = summary.ids;
     }
 
     return ids_in_html;
 }
 
-tuple<QString, QStringList> Book::GetIdsInHTMLFileMapped( HTMLResource* html_resource )
-{
-    return make_tuple(html_resource->Filename(), 
-        XhtmlDoc::GetAllDescendantIDs(*XhtmlDoc::LoadTextIntoDocument(html_resource->GetText()).get()->getDocumentElement()));
-}
-
 QStringList Book::GetIdsInHTMLFile( HTMLResource* html_resource )
 {
-    return XhtmlDoc::GetAllDescendantIDs(*XhtmlDoc::LoadTextIntoDocument(html_resource->GetText()).get()->getDocumentElement());
+    return GetHTMLSummary(html_resource).ids;
 }
 
 QHash<QString, QStringList> Book::GetClassesInHTMLFiles()
 {
     QHash<QString, QStringList> classes_in_html;
 
-    const QList<HTMLResource*> html_resources = m_Mainfolder.GetResourceTypeList< HTMLResource >(false);
-
-    QFuture< tuple<QString, QStringList> > future = QtConcurrent::mapped(html_resources, GetClassesInHTMLFileMapped);
-
-    for (int i = 0; i < future.results().count(); i++) {
-        QString filename;
-        QStringList class_names;
-        tie(filename, class_names) = future.resultAt(i);
-
+    foreach (const HTMLSummary &summary, GetHTMLSummaries()) {
         // Each class entry has a list of filenames that contain it
-        foreach (QString class_name, class_names) {
-            classes_in_html[class_name].append(filename);
+        foreach (QString class_name, summary.classes) {
+            classes_in_html[class_name].append(summary.filename);
         }
     }
 
     return classes_in_html;
 }
 
-tuple<QString, QStringList> Book::GetClassesInHTMLFileMapped(HTMLResource *html_resource)
-{
-    return make_tuple(html_resource->Filename(), 
-            XhtmlDoc::GetAllDescendantClasses(*XhtmlDoc::LoadTextIntoDocument(html_resource->GetText()).get()->getDocumentElement()));
-}
-
 QStringList Book::GetClassesInHTMLFile(QString filename)
 {
     QList<HTMLResource*> html_resources = m_Mainfolder.GetResourceTypeList< HTMLResource >(true);
 
     foreach (HTMLResource *html_resource, html_resources) {
         if (html_resource->Filename() == filename) {
-            return XhtmlDoc::GetAllDescendantClasses(*XhtmlDoc::LoadTextIntoDocument(html_resource->GetText()).get()->getDocumentElement());
+            return GetHTMLSummary(html_resource).classes;
         }
     }
 
@@ -501,15 +516,8 @@ QHash<QString, QStringList> Book::GetImagesInHTMLFiles()
 {
     QHash<QString, QStringList> images_in_html;
 
-    const QList<HTMLResource*> html_resources = m_Mainfolder.GetResourceTypeList< HTMLResource >(false);
-
-    QFuture< tuple<QString, QStringList> > future = QtConcurrent::mapped(html_resources, GetImagesInHTMLFileMapped);
-
-    for (int i = 0; i < future.results().count(); i++) {
-        QString filename;
-        QStringList images;
-        tie(filename, images) = future.resultAt(i);
-        images_in_html[filename] = images;
+    foreach (const HTMLSummary &summary, GetHTMLSummaries()) {
+        images_in_html[summary.filename] = summary.images;
     }
 
     return images_in_html;
@@ -519,40 +527,32 @@ QHash<QString, QStringList> Book::GetHTMLFilesUsingImages()
 {
     QHash<QString, QStringList> image_html_files;
 
-    const QList<HTMLResource*> html_resources = m_Mainfolder.GetResourceTypeList< HTMLResource >(false);
-
-    QFuture< tuple<QString, QStringList> > future = QtConcurrent::mapped(html_resources, GetImagesInHTMLFileMapped);
-
-    for (int i = 0; i < future.results().count(); i++) {
-        QString html_filename;
-        QStringList image_filenames;
-        tie(html_filename, image_filenames) = future.resultAt(i);
-
-        foreach (QString image_filename, image_filenames) {
-            image_html_files[image_filename].append(html_filename);
+    foreach (const HTMLSummary &summary, GetHTMLSummaries()) {
+        foreach (QString image_filename, summary.images) {
+            image_html_files[image_filename].append(summary.filename);
         }
     }
 
     return image_html_files;
 }
 
-
-tuple<QString, QStringList> Book::GetImagesInHTMLFileMapped(HTMLResource *html_resource)
-{
-    return make_tuple(html_resource->Filename(), 
-            XhtmlDoc::GetAllImagePathsFromImageChildren(*XhtmlDoc::LoadTextIntoDocument(html_resource->GetText()).get()));
-}
-
 QSet<QString> Book::GetWordsInHTMLFiles()
 {
     QStringList all_words;
 
     const QList<HTMLResource*> html_resources = m_Mainfolder.GetResourceTypeList< HTMLResource >(false);
 
-    QFuture<QStringList> future = QtConcurrent::mapped(html_resources, GetWordsInHTMLFileMapped);
+    QProgressDialog progress(QObject::tr("Collecting words..."), QObject::tr("Cancel"), 0, html_resources.count());
+    progress.setMinimumDuration(PROGRESS_BAR_MINIMUM_DURATION);
+    progress.setWindowModality(Qt::ApplicationModal);
+
+    FutureCollector<QStringList> collector(QtConcurrent::mapped(html_resources, GetWordsInHTMLFileMapped));
 
-    for (int i = 0; i < future.results().count(); i++) {
-        QStringList result = future.resultAt(i);
+    if (!collector.Wait(&progress)) {
+        return QSet<QString>();
+    }
+
+    foreach (const QStringList &result, collector.Results()) {
         all_words.append(result);
     }
 
@@ -568,29 +568,27 @@ QHash<QString, QStringList> Book::GetStylesheetsInHTMLFiles()
 {
     QHash<QString, QStringList> links_in_html;
 
-    const QList<HTMLResource*> html_resources = m_Mainfolder.GetResourceTypeList< HTMLResource >(false);
-
-    QFuture< boost::tuple<QString, QStringList> > future = QtConcurrent::mapped(html_resources, GetStylesheetsInHTMLFileMapped);
-
-    for (int i = 0; i < future.results().count(); i++) {
-        QString filename;
-        QStringList links;
-        tie(filename, links) = future.resultAt(i);
-        links_in_html[filename] = links;
+    foreach (const HTMLSummary &summary, GetHTMLSummaries()) {
+        links_in_html[summary.filename] = summary.stylesheets;
     }
 
     return links_in_html;
 }
 
-tuple<QString, QStringList> Book::GetStylesheetsInHTMLFileMapped(HTMLResource *html_resource)
+QStringList Book::GetStylesheetsInHTMLFile(HTMLResource *html_resource)
 {
-    return make_tuple(html_resource->Filename(), 
-            XhtmlDoc::GetLinkedStylesheets(html_resource->GetText()));
+    return GetHTMLSummary(html_resource).stylesheets;
 }
 
-QStringList Book::GetStylesheetsInHTMLFile(HTMLResource *html_resource)
+QHash<QString, int> Book::CountAllLinksInHTML()
 {
-    return XhtmlDoc::GetLinkedStylesheets(html_resource->GetText());
+    QHash<QString, int> links_in_html;
+
+    foreach (const HTMLSummary &summary, GetHTMLSummaries()) {
+        links_in_html[summary.filename] = summary.hrefs.count();
+    }
+
+    return links_in_html;
 }
 
 // Merge selected html files into the first document - already checked for well-formed data
@@ -638,7 +636,7 @@ bool Book::Merge( HTMLResource& html_resource1, HTMLResource& html_resource2 )
 
         xc::DOMNode &sink_body_node = *sink_body_nodes.item( 0 );
         sink_body_node.appendChild( sink_dom.importNode( body_children_fragment, true ) );
-        html_resource1.SetText(XhtmlDoc::GetDomDocumentAsString(sink_dom));
+        html_resource1.SetText(XhtmlDoc::GetDomDocumentAsString(sink_dom), HTMLResource::GetPathsToLinkedResources(sink_dom));
 
         html_resource2.Delete();
     }
@@ -666,11 +664,108 @@ bool Book::Merge( HTMLResource& html_resource1, HTMLResource& html_resource2 )
 }
 
 
-void Book::SaveAllResourcesToDisk()
+bool Book::RenameResources( const QHash< Resource*, QString > &new_filenames )
 {
-    QList< Resource* > resources = m_Mainfolder.GetResourceList(); 
+    QHash< Resource*, QString > old_filenames;
+    QHash< Resource*, QString > old_fullpaths;
+
+    foreach( Resource *resource, new_filenames.keys() )
+    {
+        if ( new_filenames.value( resource ) == resource->Filename() )
+
+            continue;
+
+        old_filenames[ resource ] = resource->Filename();
+        old_fullpaths[ resource ] = resource->GetFullPath();
+    }
+
+    if ( old_filenames.isEmpty() )
+
+        return true;
+
+    // The files are first moved out of the way to temporary names,
+    // so a file can take the old name of another file in the batch.
+    QHash< Resource*, QString > temp_filenames;
+
+    foreach( Resource *resource, old_filenames.keys() )
+    {
+        QString temp_filename = Utility::CreateUUID();
+        const QString &extension = QFileInfo( old_filenames.value( resource ) ).suffix();
+
+        if ( !extension.isEmpty() )
+
+            temp_filename.append( "." ).append( extension );
+
+        if ( !resource->RenameTo( temp_filename ) )
+        {
+            RestoreFilenames( old_filenames, temp_filenames );
+
+            return false;
+        }
+
+        temp_filenames[ resource ] = temp_filename;
+    }
+
+    QHash< QString, QString > updates;
+
+    foreach( Resource *resource, old_filenames.keys() )
+    {
+        if ( !resource->RenameTo( new_filenames.value( resource ) ) )
+        {
+            RestoreFilenames( old_filenames, temp_filenames );
+
+            return false;
+        }
+
+        updates[ old_fullpaths.value( resource ) ] = "../" + resource->GetRelativePathToOEBPS();
+    }
+
+    UniversalUpdates::PerformUniversalUpdates( true, m_Mainfolder.GetResourceList(), updates );
+
+    return true;
+}
+
+
+void Book::RestoreFilenames( const QHash< Resource*, QString > &old_filenames,
+                             const QHash< Resource*, QString > &temp_filenames )
+{
+    foreach( Resource *resource, temp_filenames.keys() )
+    {
+        if ( resource->Filename() != temp_filenames.value( resource ) )
+
+            resource->RenameTo( temp_filenames.value( resource ) );
+    }
+
+    foreach( Resource *resource, temp_filenames.keys() )
+    {
+        resource->RenameTo( old_filenames.value( resource ) );
+    }
+}
+
+
+int Book::SaveAllResourcesToDisk()
+{
+    QList< Resource* > resources;
+
+    foreach( Resource *resource, m_Mainfolder.GetResourceList() )
+    {
+        // Resources that haven't changed since they were last
+        // loaded or saved already have their data on disk.
+        if ( resource->IsDirty() )
+
+            resources.append( resource );
+    }
 
     QtConcurrent::blockingMap( resources, SaveOneResourceToDisk );
+
+    m_LastSaveWriteCount = resources.count();
+    return m_LastSaveWriteCount;
+}
+
+
+int Book::GetLastSaveWriteCount() const
+{
+    return m_LastSaveWriteCount;
 }
 
 
@@ -726,27 +821,28 @@ Book::NewChapterResult Book::CreateOneNewChapter( NewChapter chapter_info,
                                          const QHash<QString, QString> &html_updates )
 {
     QString filename = chapter_info.new_file_prefix % "_" % QString( "%1" ).arg( chapter_info.file_suffix + 1, 4, 10, QChar( '0' ) ) + ".xhtml";
-    QString fullfilepath = chapter_info.temp_folder_path + "/" + filename;
-
-    Utility::WriteUnicodeTextFile( "PLACEHOLDER", fullfilepath );
+    QString fullfilepath = m_Mainfolder.GetFullPathToTextFolder() + "/" + filename;
 
+    // The placeholder goes straight into the book folder. The caller adds 
+    // the new chapters to the OPF, all of them at once.
     HTMLResource *html_resource = qobject_cast< HTMLResource* >(
-        &m_Mainfolder.AddContentFileToFolder( fullfilepath ) );
+        &m_Mainfolder.AddContentToFolder( fullfilepath, PLACEHOLDER_TEXT.toUtf8(), false ) );
 
     Q_ASSERT( html_resource );
 
     if ( html_updates.isEmpty() )
     {
-        html_resource->SetText( CleanSource::Clean( chapter_info.source ) );
+        html_resource->SetText( chapter_info.source );
     }
 
     else
     {
-        html_resource->SetText(
-            XhtmlDoc::GetDomDocumentAsString( *PerformHTMLUpdates( CleanSource::Clean( chapter_info.source ),
-                                html_updates,
-                                QHash< QString, QString >()
-                              )().get() ) );
+        shared_ptr< xc::DOMDocument > document = PerformHTMLUpdates( CleanSource::Clean( chapter_info.source ),
+                                                                     html_updates,
+                                                                     QHash< QString, QString >() )();
+
+        html_resource->SetUpdatedText( XhtmlDoc::GetDomDocumentAsString( *document.get() ),
+                                       HTMLResource::GetPathsToLinkedResources( *document.get() ) );
     }
 
     NewChapterResult chapter;
@@ -755,3 +851,113 @@ Book::NewChapterResult Book::CreateOneNewChapter( NewChapter chapter_info,
 
     return chapter;
 }
+
+
+QList< Book::HTMLSummary > Book::GetHTMLSummaries()
+{
+    const QList< HTMLResource* > html_resources = m_Mainfolder.GetResourceTypeList< HTMLResource >( false );
+
+    QList< HTMLResource* > stale_resources;
+
+    foreach( HTMLResource *html_resource, html_resources )
+    {
+        if ( !IsHTMLSummaryCurrent( html_resource ) )
+
+            stale_resources.append( html_resource );
+    }
+
+    if ( !stale_resources.isEmpty() )
+    {
+        QProgressDialog progress( QObject::tr( "Reading HTML files..." ), QObject::tr( "Cancel" ), 0, stale_resources.count() );
+        progress.setMinimumDuration( PROGRESS_BAR_MINIMUM_DURATION );
+        progress.setWindowModality( Qt::ApplicationModal );
+
+        FutureCollector< HTMLSummary > collector( QtConcurrent::mapped( stale_resources, SummarizeHTMLFile ) );
+        collector.Wait( &progress );
+
+        // The files read before a cancel are kept for the next query.
+        const QList< HTMLSummary > &new_summaries = collector.Results();
+
+        for ( int i = 0; i < new_summaries.count(); ++i )
+        {
+            m_HTMLSummaries.insert( stale_resources[ i ]->GetIdentifier(), new_summaries[ i ] );
+        }
+    }
+
+    QList< HTMLSummary > summaries;
+    QHash< QString, HTMLSummary > current_summaries;
+
+    foreach( HTMLResource *html_resource, html_resources )
+    {
+        const QString &identifier = html_resource->GetIdentifier();
+
+        // Only left out if the user canceled the reading.
+        if ( !IsHTMLSummaryCurrent( html_resource ) )
+
+            continue;
+
+        HTMLSummary summary = m_HTMLSummaries.value( identifier );
+        summary.filename = html_resource->Filename();
+
+        summaries.append( summary );
+        current_summaries.insert( identifier, summary );
+    }
+
+    // Drop the summaries of the files that were removed from the book.
+    m_HTMLSummaries = current_summaries;
+
+    return summaries;
+}
+
+
+Book::HTMLSummary Book::GetHTMLSummary( HTMLResource *html_resource )
+{
+    if ( !IsHTMLSummaryCurrent( html_resource ) )
+
+        m_HTMLSummaries.insert( html_resource->GetIdentifier(), SummarizeHTMLFile( html_resource ) );
+
+    HTMLSummary summary = m_HTMLSummaries.value( html_resource->GetIdentifier() );
+    summary.filename = html_resource->Filename();
+
+    return summary;
+}
+
+
+bool Book::IsHTMLSummaryCurrent( HTMLResource *html_resource ) const
+{
+    QHash< QString, HTMLSummary >::const_iterator summary =
+        m_HTMLSummaries.constFind( html_resource->GetIdentifier() );
+
+    return summary != m_HTMLSummaries.constEnd() &&
+           summary->generation == html_resource->GetModificationGeneration();
+}
+
+
+Book::HTMLSummary Book::SummarizeHTMLFile( HTMLResource *html_resource )
+{
+    QReadLocker locker( &html_resource->GetLock() );
+
+    // The generation is read under the lock,
+    // so it's the one of the text we parse.
+    HTMLSummary summary;
+    summary.filename   = html_resource->Filename();
+    summary.generation = html_resource->GetModificationGeneration();
+
+    shared_ptr< xc::DOMDocument > document = XhtmlDoc::LoadTextIntoDocument( html_resource->GetText() );
+
+    summary.ids         = XhtmlDoc::GetAllDescendantIDs( *document->getDocumentElement() );
+    summary.classes     = XhtmlDoc::GetAllDescendantClasses( *document->getDocumentElement() );
+    summary.images      = XhtmlDoc::GetAllImagePathsFromImageChildren( *document );
+    summary.stylesheets = XhtmlDoc::GetLinkedStylesheets( *document );
+
+    QList< xc::DOMElement* > anchors = XhtmlDoc::GetTagMatchingDescendants( *document, "a" );
+
+    foreach( xc::DOMElement *anchor, anchors )
+    {
+        if ( anchor->hasAttribute( QtoX( "href" ) ) )
+
+            summary.hrefs.append( XtoQ( anchor->getAttribute( QtoX( "href" ) ) ) );
+    }
+
+    return summary;
+}
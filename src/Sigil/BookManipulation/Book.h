@@ -27,6 +27,7 @@
 
 #include <QtCore/QHash>
 #include <QtCore/QObject>
+#include <QtCore/QStringList>
 #include <QtCore/QUrl>
 #include <QtCore/QVariant>
 #include "BookManipulation/Metadata.h"
@@ -189,6 +190,29 @@ public:
     void CreateNewChapters( const QStringList& new_chapters,
                             HTMLResource& originalResource );
 
+    /**
+     * Creates the new chapters/XHTML documents split off from several
+     * files at once. All the chapters are created in parallel, added
+     * to the OPF together, and the anchors across the book are updated
+     * in one pass.
+     *
+     * @param new_chapters The contents of the new chapters, keyed by
+     *                     the original HTML chapter they will be 
+     *                     created after.
+     */
+    void CreateNewChapters( const QHash< HTMLResource*, QStringList > &new_chapters );
+
+    /**
+     * Splits the HTML files on their SGF chapter markers. The chapters
+     * are found in parallel; the files are then given the text of their
+     * first chapter and the other chapters are created with 
+     * CreateNewChapters( const QHash< HTMLResource*, QStringList >& ).
+     *
+     * @param html_resources The files to split.
+     * @return The files that had chapter markers and were split.
+     */
+    QList< HTMLResource* > SplitOnSGFChapterMarkers( const QList< HTMLResource* > &html_resources );
+
     /**
      * Returns the previous resource, or the same resource if at top of folder
      *
@@ -196,25 +220,32 @@ public:
      */
     Resource* PreviousResource( Resource *resource );
 
+    /**
+     * The ids, classes, images and linked stylesheets of the HTML files
+     * come from summaries of the files that are kept until the files
+     * change. So only the files changed since the last query are parsed.
+     * @see GetHTMLSummaries()
+     */
     QHash<QString, QStringList> GetIdsInHTMLFiles();
-    static boost::tuple<QString, QStringList> GetIdsInHTMLFileMapped( HTMLResource* html_resource );
     QStringList GetIdsInHTMLFile( HTMLResource* html_resource );
 
     QHash<QString, QStringList> GetClassesInHTMLFiles();
-    static boost::tuple<QString, QStringList> GetClassesInHTMLFileMapped(HTMLResource *html_resource);
     QStringList GetClassesInHTMLFile(QString filename);
 
     QSet<QString> GetWordsInHTMLFiles();
     static QStringList GetWordsInHTMLFileMapped(HTMLResource *html_resource);
 
     QHash<QString, QStringList> GetStylesheetsInHTMLFiles();
-    static boost::tuple<QString, QStringList> GetStylesheetsInHTMLFileMapped(HTMLResource *html_resource);
     QStringList GetStylesheetsInHTMLFile(HTMLResource *html_resource);
 
     QHash<QString, QStringList> GetImagesInHTMLFiles();
     QHash<QString, QStringList> GetHTMLFilesUsingImages();
-    static boost::tuple<QString, QStringList> GetImagesInHTMLFileMapped(HTMLResource *html_resource);
 
+    /**
+     * Counts the hyperlinks in every HTML file.
+     *
+     * @return The number of hyperlinks, keyed by HTML filename.
+     */
     QHash<QString, int> CountAllLinksInHTML();
 
     /**
@@ -224,11 +255,37 @@ public:
      */
     bool Merge( HTMLResource& html_resource1, HTMLResource& html_resource2 );
 
+    /**
+     * Renames a batch of resources. The references to all of them are
+     * updated with one pass over the book's files, which runs in parallel.
+     * The batch is renamed as a unit: if one of the files can't be
+     * renamed, the files renamed before it get their old names back
+     * and nothing is updated. A new filename can be the old filename
+     * of another file in the batch, so files can be renumbered or
+     * swap names.
+     *
+     * @param new_filenames The new filenames (with extensions),
+     *                      keyed by the resources to rename.
+     * @return \c true if all the resources were renamed.
+     */
+    bool RenameResources( const QHash< Resource*, QString > &new_filenames );
+
     /**
      * Makes sure that all the resources have saved the state of 
-     * their caches to the disk.
+     * their caches to the disk. Only the resources modified since
+     * they were last saved are written out.
+     *
+     * @return The number of resources written to disk.
+     */
+    int SaveAllResourcesToDisk();
+
+    /**
+     * Returns the number of resources that the last
+     * SaveAllResourcesToDisk() call wrote to disk.
+     *
+     * @return The number of resources written.
      */
-    void SaveAllResourcesToDisk();
+    int GetLastSaveWriteCount() const;
 
     /**
      * Returns the modified state of the book. A book
@@ -292,13 +349,10 @@ private:
         // The source code of the new chapter.
         QString source;
 
-        // The reading order of the new chapter.
+        // The position of the new chapter among the
+        // chapters split off from the same file.
         int reading_order;
 
-        // The path to the temporary folder where the new file will be
-        // created before being copied to the folderkeeper.
-        QString temp_folder_path;
-
         // Prefix used when creating the filename.
         QString new_file_prefix;
 
@@ -311,7 +365,7 @@ private:
         // Chatper that was created.
         HTMLResource *created_chapter;
 
-        // Position in the reading order of this chapter.
+        // Position of this chapter among the chapters split off from the same file.
         int reading_order;
     };
 
@@ -321,6 +375,29 @@ private:
      */
     static void SaveOneResourceToDisk( Resource *resource );
 
+    /**
+     * Finds the chapters of one file by its SGF chapter markers.
+     * The file itself is not modified.
+     *
+     * @param html_resource The file to split.
+     * @return The contents of all the chapters of the file,
+     *         starting with the one that stays in the file.
+     * @see XhtmlDoc::GetSGFChapterSplits()
+     */
+    static QStringList SplitOneFileOnSGFChapterMarkers( HTMLResource *html_resource );
+
+    /**
+     * Gives the resources of a failed batch rename their old filenames
+     * back. The resources are moved to their temporary filenames first,
+     * so their old filenames are free again.
+     *
+     * @param old_filenames The filenames before the batch rename.
+     * @param temp_filenames The temporary filenames of the resources
+     *                       that were moved out of the way.
+     */
+    static void RestoreFilenames( const QHash< Resource*, QString > &old_filenames,
+                                  const QHash< Resource*, QString > &temp_filenames );
+
     /**
      * Creates one new chapter/XHTML document.
      *
@@ -339,6 +416,57 @@ private:
     NewChapterResult CreateOneNewChapter( NewChapter chapter_info,
                                        const QHash< QString, QString > &html_updates );
 
+    // What the reports and dialogs ask about an HTML file.
+    struct HTMLSummary {
+        // The filename of the file when it was last queried.
+        QString filename;
+
+        // The modification generation of the text that was summarized.
+        int generation;
+
+        QStringList ids;
+        QStringList classes;
+        QStringList images;
+        QStringList stylesheets;
+
+        // The targets of the hyperlinks.
+        QStringList hrefs;
+
+        HTMLSummary() : generation( -1 ) {}
+    };
+
+    /**
+     * Returns the summaries of all the HTML files. Only the files
+     * that changed since they were last summarized are parsed,
+     * and that is done in parallel, with a progress dialog.
+     *
+     * @return The summaries, in the order of the HTML files. If the user
+     *         cancels the reading, the files not read are left out.
+     */
+    QList< HTMLSummary > GetHTMLSummaries();
+
+    /**
+     * Returns the summary of one HTML file, parsing it only if
+     * it changed since it was last summarized.
+     *
+     * @param html_resource The file to summarize.
+     */
+    HTMLSummary GetHTMLSummary( HTMLResource *html_resource );
+
+    /**
+     * Checks if the kept summary of the file is still up to date.
+     *
+     * @param html_resource The file to check.
+     */
+    bool IsHTMLSummaryCurrent( HTMLResource *html_resource ) const;
+
+    /**
+     * Parses the file and summarizes it.
+     *
+     * @param html_resource The file to summarize.
+     */
+    static HTMLSummary SummarizeHTMLFile( HTMLResource *html_resource );
+
 
     ////////////////////////////
     // PRIVATE MEMBER VARIABLES
@@ -362,6 +490,18 @@ private:
      */
     bool m_IsModified;
 
+    /**
+     * The number of resources written by the
+     * last SaveAllResourcesToDisk() call.
+     */
+    int m_LastSaveWriteCount;
+
+    /**
+     * The summaries of the HTML files, keyed by resource identifier.
+     * @see GetHTMLSummaries()
+     */
+    QHash< QString, HTMLSummary > m_HTMLSummaries;
+
 };
 
 #endif // BOOK_H
@@ -81,7 +81,8 @@ void BookNormalization::GiveIDsToHeadingsInResource( HTMLResource *html_resource
         }
     }
     if (resource_updated) {
-        html_resource->SetText(XhtmlDoc::GetDomDocumentAsString(*headings.at(0).document));
+        html_resource->SetText(XhtmlDoc::GetDomDocumentAsString(*headings.at(0).document),
+                               HTMLResource::GetPathsToLinkedResources(*headings.at(0).document));
     }
 }
 
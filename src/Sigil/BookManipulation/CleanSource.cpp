@@ -19,11 +19,15 @@
 **
 *************************************************************************/
 
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
 #include <boost/tuple/tuple.hpp>
 #include <buffio.h>
 
+#include <QtCore/QHash>
 #include <QtCore/QString>
 #include <QtCore/QStringList>
+#include <QtCore/QThreadStorage>
 
 #include "BookManipulation/CleanSource.h"
 #include "BookManipulation/XhtmlDoc.h"
@@ -33,6 +37,7 @@
 #include "Misc/Utility.h"
 
 using boost::make_tuple;
+using boost::shared_ptr;
 using boost::tie;
 using boost::tuple;
 
@@ -66,6 +71,38 @@ static const QString SVG_ELEMENTS         = "a,altGlyph,altGlyphDef,altGlyphItem
                                             ",use,view,vkern";
 
 
+// A Tidy document along with the buffer it writes its errors to.
+// Tidy keeps a document's options between runs, so we keep one
+// configured document per TidyType and thread around instead of
+// setting up all the options (the SVG block tags in particular)
+// for every run.
+struct ConfiguredTidyDoc : private boost::noncopyable
+{
+    ConfiguredTidyDoc() 
+        : document( tidyCreate() )
+    {
+        tidyBufInit( &errbuf );
+
+        // Write all errors to error buffer
+        tidySetErrorBuffer( document, &errbuf );
+    }
+
+    ~ConfiguredTidyDoc()
+    {
+        tidyRelease( document );
+        tidyBufFree( &errbuf );
+    }
+
+    TidyDoc document;
+    TidyBuffer errbuf;
+};
+
+// The keys are TidyType values
+typedef QHash< int, shared_ptr< ConfiguredTidyDoc > > TidyDocsByType;
+
+static QThreadStorage< TidyDocsByType* > s_TidyDocs;
+
+
 // Performs general cleaning (and improving)
 // of provided book XHTML source code
 QString CleanSource::Clean( const QString &source )
@@ -149,6 +186,14 @@ QString CleanSource::ProcessXML( const QString &source )
 }
 
 
+QString CleanSource::ProcessXML( const QByteArray &source )
+{
+    QByteArray output = HTMLTidy( source, Tidy_XML );
+
+    return RemoveMetaCharset( QString::fromUtf8( output.constData(), output.size() ) );
+}
+
+
 int CleanSource::RobustCSSStyleTagCount( const QString &source )
 {
     int head_end_index = source.indexOf( QRegExp( HEAD_END ) );
@@ -294,7 +339,34 @@ int CleanSource::MaxSigilCSSClassIndex( const QStringList &css_style_tags  )
 }
 
 
-TidyDoc CleanSource::TidyOptions( TidyDoc tidy_document, TidyType type, int max_class_index )
+// Returns the largest index of all the Sigil CSS classes
+// used in the CSS style tags of the <head> section.
+// This is a plain text scan so we don't need a full XML
+// parse of source that may not even be well-formed.
+int CleanSource::MaxSigilCSSClassIndexInHead( const QString &source )
+{
+    int head_end_index = source.indexOf( QRegExp( HEAD_END ) );
+
+    QString head = Utility::Substring( 0, head_end_index, source );
+
+    QRegExp css_styles_reg( STYLE_TAG_CSS_ONLY );
+    css_styles_reg.setMinimal( true );
+
+    QStringList css_style_tags;
+    int index = 0;
+
+    while ( ( index = css_styles_reg.indexIn( head, index ) ) != -1 )
+    {
+        css_style_tags.append( css_styles_reg.cap( 0 ) );
+
+        index += css_styles_reg.matchedLength();
+    }
+
+    return MaxSigilCSSClassIndex( css_style_tags );
+}
+
+
+TidyDoc CleanSource::TidyOptions( TidyDoc tidy_document, TidyType type )
 {
     // For more information on Tidy configuration
     // options, see http://tidy.sourceforge.net/docs/quickref.html
@@ -348,11 +420,6 @@ TidyDoc CleanSource::TidyOptions( TidyDoc tidy_document, TidyType type, int max_
 
         // "css-prefix"
         tidyOptSetValue( tidy_document, TidyCSSPrefix, SIGIL_CLASS_NAME.toUtf8().data() );
-
-        // This option doesn't exist in "normal" Tidy. It has been hacked on
-        // and enables us to direct Tidy to start numbering new CSS classes
-        // from an index we provide it, and not always from 1 (which causes clashes).
-        tidyOptSetInt( tidy_document, TidyClassStartID, max_class_index );
     }
 
     // "doctype"
@@ -396,24 +463,59 @@ QString CleanSource::HTMLTidy( const QString &source, TidyType type )
 
         return QString();
 
-    TidyDoc tidy_document = tidyCreate();
+    int max_class_index = type == Tidy_Clean ? MaxSigilCSSClassIndexInHead( source ) : 0;
 
-    TidyBuffer output = { 0 };
-    TidyBuffer errbuf = { 0 };
+    QByteArray output = HTMLTidy( source.toUtf8(), type, max_class_index );
 
-    if ( type == Tidy_Clean )
+    return RemoveMetaCharset( QString::fromUtf8( output.constData(), output.size() ) );
+}
 
-        tidy_document = TidyOptions( tidy_document, type, MaxSigilCSSClassIndex( CSSStyleTags( source ) ) );
 
-    else
+// Runs HTML Tidy on the provided UTF-8 encoded source code;
+// returns the UTF-8 encoded result
+QByteArray CleanSource::HTMLTidy( const QByteArray &source, TidyType type, int max_class_index )
+{
+    if ( source.isEmpty() )
+
+        return QByteArray();
+
+    if ( !s_TidyDocs.hasLocalData() )
+
+        s_TidyDocs.setLocalData( new TidyDocsByType() );
+
+    shared_ptr< ConfiguredTidyDoc > &tidy_doc = ( *s_TidyDocs.localData() )[ type ];
 
-        tidy_document = TidyOptions( tidy_document, type );
+    if ( !tidy_doc )
+    {
+        tidy_doc = shared_ptr< ConfiguredTidyDoc >( new ConfiguredTidyDoc() );
+        TidyOptions( tidy_doc->document, type );
+        tidyOptSnapshot( tidy_doc->document );
+    }
+
+    TidyDoc tidy_document = tidy_doc->document;
+
+    // Tidy changes some options while parsing (it turns on
+    // the XML options when it finds a namespace, and takes the
+    // input encoding from a BOM). Those must not carry over
+    // to the next document, so we start from our own options.
+    // Tidy snapshots the options again when it starts parsing,
+    // which is always from this reset state.
+    tidyOptResetToSnapshot( tidy_document );
+
+    // TODO: read and report any possible errors
+    // from the error buffer; for now we just
+    // make sure it doesn't grow from run to run
+    tidyBufClear( &tidy_doc->errbuf );
+
+    if ( type == Tidy_Clean )
 
-    // Write all errors to error buffer
-    tidySetErrorBuffer( tidy_document, &errbuf );
+        // This option doesn't exist in "normal" Tidy. It has been hacked on
+        // and enables us to direct Tidy to start numbering new CSS classes
+        // from an index we provide it, and not always from 1 (which causes clashes).
+        tidyOptSetInt( tidy_document, TidyClassStartID, max_class_index );
 
     // Set the input
-    tidyParseString( tidy_document, source.toUtf8().constData() );
+    tidyParseString( tidy_document, source.constData() );
 
     // GO BABY GO!
     tidyCleanAndRepair( tidy_document );
@@ -421,20 +523,14 @@ QString CleanSource::HTMLTidy( const QString &source, TidyType type )
     // Run diagnostics
     tidyRunDiagnostics( tidy_document );
 
-    // TODO: read and report any possible errors
-    // from the error buffer
-
     // Store the cleaned up XHTML
+    TidyBuffer output = { 0 };
     tidySaveBuffer( tidy_document, &output );
 
-    QString clean = QString::fromUtf8( (const char*) output.bp );
+    QByteArray clean( (const char*) output.bp, output.size );
 
     // Free memory
     tidyBufFree( &output );
-    tidyBufFree( &errbuf );
-    tidyRelease( tidy_document );
-
-    clean = RemoveMetaCharset( clean );
 
     return clean;
 }
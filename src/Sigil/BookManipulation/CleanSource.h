@@ -49,6 +49,10 @@ public:
 
     static QString ProcessXML( const QString &source );
 
+    // Like ProcessXML( const QString& ), but for UTF-8 encoded
+    // source; saves a round trip through UTF-16 for raw file data
+    static QString ProcessXML( const QByteArray &source );
+
 private:
 
     enum TidyType
@@ -86,11 +90,19 @@ private:
     // Returns the largest index of all the Sigil CSS classes
     static int MaxSigilCSSClassIndex(       const QStringList &css_style_tags );
 
-    static TidyDoc TidyOptions( TidyDoc tidy_document, TidyType type, int max_class_index = 0 );
+    // Returns the largest index of all the Sigil CSS classes
+    // used in the CSS style tags of the <head> section
+    static int MaxSigilCSSClassIndexInHead( const QString &source );
+
+    static TidyDoc TidyOptions( TidyDoc tidy_document, TidyType type );
 
     // Runs HTML Tidy on the provided XHTML source code
     static QString HTMLTidy( const QString &source, TidyType type );
 
+    // Runs HTML Tidy on the provided UTF-8 encoded source code;
+    // returns the UTF-8 encoded result
+    static QByteArray HTMLTidy( const QByteArray &source, TidyType type, int max_class_index = 0 );
+
     // Writes the new CSS style tags to the source, replacing the old ones
     static QString WriteNewCSSStyleTags( const QString &source, const QStringList &css_style_tags );
 
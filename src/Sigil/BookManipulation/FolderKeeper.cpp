@@ -119,6 +119,24 @@ Resource& FolderKeeper::AddContentFileToFolder( const QString &fullfilepath,
 
         boost_throw( FileDoesNotExist() << errinfo_file_name( fullfilepath.toStdString() ) );
 
+    return AddFileToFolder( fullfilepath, NULL, update_opf, mimetype );
+}
+
+
+Resource& FolderKeeper::AddContentToFolder( const QString &fullfilepath, 
+                                            const QByteArray &data,
+                                            bool update_opf,
+                                            const QString &mimetype )
+{
+    return AddFileToFolder( fullfilepath, &data, update_opf, mimetype );
+}
+
+
+Resource& FolderKeeper::AddFileToFolder( const QString &fullfilepath, 
+                                         const QByteArray *data,
+                                         bool update_opf,
+                                         const QString &mimetype )
+{
     QString new_file_path;
     QString normalised_file_path = fullfilepath;
     Resource *resource = NULL;
@@ -216,7 +234,22 @@ Resource& FolderKeeper::AddContentFileToFolder( const QString &fullfilepath,
         m_Resources[ resource->GetIdentifier() ] = resource;
     }
 
-    QFile::copy( fullfilepath, new_file_path );
+    if ( data )
+    {
+        QFile file( new_file_path );
+
+        if ( !file.open( QIODevice::WriteOnly | QIODevice::Truncate ) || file.write( *data ) != data->size() )
+        {
+            boost_throw( CannotCopyFile() 
+                         << errinfo_file_fullpath( new_file_path.toStdString() )
+                         << errinfo_file_errorstring( file.errorString().toStdString() ) 
+                       );
+        }
+    }
+
+    else
+
+        QFile::copy( fullfilepath, new_file_path );
 
     if ( QThread::currentThread() != QApplication::instance()->thread() )
     
@@ -23,6 +23,7 @@
 #ifndef FOLDERKEEPER_H
 #define FOLDERKEEPER_H
 
+#include <QtCore/QByteArray>
 #include <QtCore/QObject>
 #include <QtCore/QString>
 #include <QtCore/QHash>
@@ -86,6 +87,26 @@ public:
                                       bool update_opf = true,
                                       const QString &mimetype = QString() );
 
+    /**
+     * Adds a content file to the book folder from data already in memory,
+     * and returns the corresponding Resource object. The file is written
+     * straight to its place in the book folder; it doesn't have to exist 
+     * at the provided path.
+     * 
+     * @param fullfilepath The full path the file would have on disk. This
+     *                     is used to determine the type and the name 
+     *                     of the file.
+     * @param data The contents of the file.
+     * @param update_opf If set to \c true, then the OPF will be notified
+     *                   that a file was added.
+     * @param mimetype The mimetype for the associated file.
+     * @return The newly created resource.
+     */
+    Resource& AddContentToFolder( const QString &fullfilepath, 
+                                  const QByteArray &data,
+                                  bool update_opf = true,
+                                  const QString &mimetype = QString() );
+
     /**
      * Returns the highest reading order number present in the book.
      *
@@ -251,6 +272,18 @@ private slots:
 
 private:
 
+    /**
+     * Adds a file to the book folder. The contents are copied from
+     * fullfilepath, unless the data is provided.
+     * 
+     * @see AddContentFileToFolder()
+     * @param data The contents of the file, or NULL.
+     */
+    Resource& AddFileToFolder( const QString &fullfilepath, 
+                               const QByteArray *data,
+                               bool update_opf,
+                               const QString &mimetype );
+
     /**
      * Registers certain file types to be watched for external modifications.
      */
@@ -392,26 +425,45 @@ QList< HTMLResource* > FolderKeeper::ListResourceSort< HTMLResource >( const QLi
 {
     QStringList spine_order_filenames = GetOPF().GetSpineOrderFilenames();
 
-    QList< HTMLResource* > htmls = resource_list;
+    QHash< QString, HTMLResource* > htmls_by_filename;
+
+    foreach( HTMLResource *html_resource, resource_list )
+    {
+        QString filename = html_resource->Filename();
+
+        if ( !htmls_by_filename.contains( filename ) )
+
+            htmls_by_filename[ filename ] = html_resource;
+    }
+
     QList< HTMLResource* > sorted_htmls;
+    QHash< HTMLResource*, int > sorted_counts;
 
     foreach( const QString &spine_filename, spine_order_filenames )
     {
-        for ( int i = 0; i < htmls.count(); ++i )
+        HTMLResource *html_resource = htmls_by_filename.take( spine_filename );
+
+        if ( html_resource )
         {
-            if ( spine_filename == htmls[ i ]->Filename() )
-            {
-                sorted_htmls.append( htmls.takeAt( i ) );
-                break;
-            }
+            sorted_htmls.append( html_resource );
+            sorted_counts[ html_resource ]++;
         }
     }
 
     // It's possible that there are certain HTML files in the
     // given resource list that are not in the spine filenames,
     // for several reasons. So we make sure we add them to the end
-    // of the sorted list.
-    sorted_htmls.append( htmls );
+    // of the sorted list, in their original order.
+    foreach( HTMLResource *html_resource, resource_list )
+    {
+        if ( sorted_counts.value( html_resource, 0 ) > 0 )
+
+            sorted_counts[ html_resource ]--;
+
+        else
+
+            sorted_htmls.append( html_resource );
+    }
 
     return sorted_htmls;
 }
@@ -73,7 +73,8 @@ QList< Headings::Heading > Headings::GetHeadingListForOneFile( HTMLResource* htm
 
     // We have to store the shared pointer and then reference it otherwise it will
     // not a have reference and the DOMDocument will be destroyed.
-    shared_ptr<xc::DOMDocument> d = XhtmlDoc::LoadTextIntoDocument(html_resource->GetText());
+    // Locations are needed to tell if the first heading is at the start of the file.
+    shared_ptr<xc::DOMDocument> d = XhtmlDoc::LoadTextIntoDocument(html_resource->GetText(), true);
     const xc::DOMDocument &document = *d.get();
     QList< xc::DOMElement *> dom_elements = XhtmlDoc::GetTagMatchingDescendants( document, "body" );
     // We want to ensure we don't try to get an element out of an empty list.
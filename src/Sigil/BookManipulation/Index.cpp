@@ -119,7 +119,7 @@ void Index::AddIndexIDsOneFile(HTMLResource *html_resource)
     }
 
     if (resource_updated) {
-        html_resource->SetText(XhtmlDoc::GetDomDocumentAsString(*d.get()));
+        html_resource->SetText(XhtmlDoc::GetDomDocumentAsString(*d.get()), HTMLResource::GetPathsToLinkedResources(*d.get()));
     }
 }
 
@@ -22,7 +22,6 @@
 *************************************************************************/
 
 #include <boost/bind/bind.hpp>
-#include <boost/scoped_ptr.hpp>
 #include <boost/shared_ptr.hpp>
 #include <xercesc/framework/MemBufInputSource.hpp>
 #include <xercesc/sax2/SAX2XMLReader.hpp>
@@ -32,6 +31,8 @@
 // XercesExtensions
 #include <LocationAwareDOMParser.h>
 #include <NodeLocationInfo.h>
+#include <ParserPool.h>
+#include <XercesStatic.h>
 #include <XmlUtils.h>
 
 #include <QtCore/QHash>
@@ -398,6 +399,75 @@ QString XhtmlDoc::GetDomNodeAsString( const xc::DOMNode &node )
 }
 
 
+// The XHTML entities and NCX DTDs are compiled once into a locked
+// grammar pool, and the parsers using it are reused across calls.
+static XercesExt::LocationAwareDOMParser* CreateDOMParser( xc::XMLGrammarPool &grammar_pool )
+{
+    XercesExt::LocationAwareDOMParser *parser = 
+        new XercesExt::LocationAwareDOMParser( 0, xc::XMLPlatformUtils::fgMemoryManager, &grammar_pool );
+
+    // This scanner ignores schemas
+    parser->useScanner( xc::XMLUni::fgDGXMLScanner );
+    parser->setValidationScheme( xc::AbstractDOMParser::Val_Never );
+    parser->useCachedGrammarInParse( true );
+    parser->setLoadExternalDTD( true );
+    parser->setDoNamespaces( true );
+
+    return parser;
+}
+
+
+static xc::SAX2XMLReader* CreateSAXParser( xc::XMLGrammarPool &grammar_pool )
+{
+    xc::SAX2XMLReader *parser = 
+        xc::XMLReaderFactory::createXMLReader( xc::XMLPlatformUtils::fgMemoryManager, &grammar_pool );
+
+    parser->setFeature( xc::XMLUni::fgSAX2CoreValidation,            false );
+    parser->setFeature( xc::XMLUni::fgXercesSchema,                  false );      
+    parser->setFeature( xc::XMLUni::fgXercesLoadSchema,              false );
+    parser->setFeature( xc::XMLUni::fgXercesUseCachedGrammarInParse, true  );
+    parser->setFeature( xc::XMLUni::fgXercesSkipDTDValidation,       true  );
+
+    // We need the DGXMLScanner because of the entities
+    parser->setProperty( xc::XMLUni::fgXercesScannerName, 
+                         (void*) xc::XMLUni::fgDGXMLScanner );    
+
+    return parser;
+}
+
+
+static XercesExt::ParserPool< XercesExt::LocationAwareDOMParser >* CreateDOMParserPool()
+{
+    xc::MemBufInputSource xhtml_dtd( XHTML_ENTITIES_DTD, XHTML_ENTITIES_DTD_LEN, XHTML_ENTITIES_DTD_ID );
+    xc::MemBufInputSource ncx_dtd( fc::NCX_2005_1_DTD, fc::NCX_2005_1_DTD_LEN, fc::NCX_2005_1_DTD_ID );
+
+    std::vector< const xc::InputSource* > dtds;
+    dtds.push_back( &xhtml_dtd );
+    dtds.push_back( &ncx_dtd );
+
+    return new XercesExt::ParserPool< XercesExt::LocationAwareDOMParser >( 
+        dtds, std::vector< const xc::InputSource* >(), CreateDOMParser );
+}
+
+
+static XercesExt::ParserPool< xc::SAX2XMLReader >* CreateSAXParserPool()
+{
+    xc::MemBufInputSource xhtml_dtd( XHTML_ENTITIES_DTD, XHTML_ENTITIES_DTD_LEN, XHTML_ENTITIES_DTD_ID );
+    xc::MemBufInputSource ncx_dtd( fc::NCX_2005_1_DTD, fc::NCX_2005_1_DTD_LEN, fc::NCX_2005_1_DTD_ID );
+
+    std::vector< const xc::InputSource* > dtds;
+    dtds.push_back( &xhtml_dtd );
+    dtds.push_back( &ncx_dtd );
+
+    return new XercesExt::ParserPool< xc::SAX2XMLReader >( 
+        dtds, std::vector< const xc::InputSource* >(), CreateSAXParser );
+}
+
+
+static XercesExt::XercesStatic< XercesExt::ParserPool< XercesExt::LocationAwareDOMParser > > s_DOMParsers( CreateDOMParserPool );
+static XercesExt::XercesStatic< XercesExt::ParserPool< xc::SAX2XMLReader > > s_SAXParsers( CreateSAXParserPool );
+
+
 // This func makes sure that the UTF-8 encoding is set for the XML declaration
 QString XhtmlDoc::GetDomDocumentAsString( const xc::DOMDocument &document )
 {
@@ -415,22 +485,10 @@ shared_ptr< xc::DOMDocument > XhtmlDoc::CopyDomDocument( const xc::DOMDocument &
 }
 
 
-shared_ptr< xc::DOMDocument > XhtmlDoc::LoadTextIntoDocument( const QString &source )
+shared_ptr< xc::DOMDocument > XhtmlDoc::LoadTextIntoDocument( const QString &source, bool track_locations )
 {
-    XercesExt::LocationAwareDOMParser parser;
-
-    // This scanner ignores schemas
-    parser.useScanner( xc::XMLUni::fgDGXMLScanner );
-    parser.setValidationScheme( xc::AbstractDOMParser::Val_Never );
-    parser.useCachedGrammarInParse( true );
-    parser.setLoadExternalDTD( true );
-    parser.setDoNamespaces( true );
-
-    xc::MemBufInputSource xhtml_dtd( XHTML_ENTITIES_DTD, XHTML_ENTITIES_DTD_LEN, XHTML_ENTITIES_DTD_ID );
-    parser.loadGrammar( xhtml_dtd, xc::Grammar::DTDGrammarType, true ); 
-
-    xc::MemBufInputSource ncx_dtd( fc::NCX_2005_1_DTD, fc::NCX_2005_1_DTD_LEN, fc::NCX_2005_1_DTD_ID );
-    parser.loadGrammar( ncx_dtd, xc::Grammar::DTDGrammarType, true ); 
+    shared_ptr< XercesExt::LocationAwareDOMParser > parser = s_DOMParsers.Get().GetParser();
+    parser->setTrackLocations( track_locations );
 
     QString prepared_source = PrepareSourceForXerces( source );
 
@@ -444,9 +502,9 @@ shared_ptr< xc::DOMDocument > XhtmlDoc::LoadTextIntoDocument( const QString &sou
     XMLCh UTF16[] = { xc::chLatin_U, xc::chLatin_T, xc::chLatin_F, xc::chDigit_1, xc::chDigit_6, xc::chNull };
     input.setEncoding( UTF16 );
 
-    parser.parse( input );
+    parser->parse( input );
 
-    return RaiiWrapDocument( parser.adoptDocument() );
+    return RaiiWrapDocument( parser->adoptDocument() );
 }
 
 
@@ -470,23 +528,7 @@ int XhtmlDoc::NodeColumnNumber( const xc::DOMNode &node )
 
 XhtmlDoc::WellFormedError XhtmlDoc::WellFormedErrorForSource( const QString &source )
 {
-    boost::scoped_ptr< xc::SAX2XMLReader > parser( xc::XMLReaderFactory::createXMLReader() );
-
-    parser->setFeature( xc::XMLUni::fgSAX2CoreValidation,            false );
-    parser->setFeature( xc::XMLUni::fgXercesSchema,                  false );      
-    parser->setFeature( xc::XMLUni::fgXercesLoadSchema,              false );
-    parser->setFeature( xc::XMLUni::fgXercesUseCachedGrammarInParse, true  );
-    parser->setFeature( xc::XMLUni::fgXercesSkipDTDValidation,       true  );
-
-    // We need the DGXMLScanner because of the entities
-    parser->setProperty( xc::XMLUni::fgXercesScannerName, 
-                         (void*) xc::XMLUni::fgDGXMLScanner );    
-
-    xc::MemBufInputSource xhtml_dtd( XHTML_ENTITIES_DTD, XHTML_ENTITIES_DTD_LEN, XHTML_ENTITIES_DTD_ID );
-    parser->loadGrammar( xhtml_dtd, xc::Grammar::DTDGrammarType, true ); 
-
-    xc::MemBufInputSource ncx_dtd( fc::NCX_2005_1_DTD, fc::NCX_2005_1_DTD_LEN, fc::NCX_2005_1_DTD_ID );
-    parser->loadGrammar( ncx_dtd, xc::Grammar::DTDGrammarType, true ); 
+    shared_ptr< xc::SAX2XMLReader > parser = s_SAXParsers.Get().GetParser();
 
     fc::ErrorResultCollector collector;
     parser->setErrorHandler( &collector );
@@ -694,6 +736,36 @@ QStringList XhtmlDoc::GetLinkedStylesheets( const QString &source )
 }
 
 
+QStringList XhtmlDoc::GetLinkedStylesheets( const xc::DOMDocument &document )
+{
+    QStringList linked_css_paths;
+
+    QList< xc::DOMElement* > heads = GetTagMatchingDescendants( document, "head" );
+
+    if ( heads.isEmpty() )
+
+        return linked_css_paths;
+
+    QList< xc::DOMElement* > links = GetTagMatchingDescendants( *heads.at( 0 ), QStringList() << "link" );
+
+    foreach( xc::DOMElement *link, links )
+    {
+        QHash< QString, QString > attributes = GetNodeAttributes( *link );
+
+        if ( attributes.contains( "type" ) &&
+             ( attributes.value( "type" ).toLower() == "text/css" ) &&
+             attributes.contains( "rel" ) &&
+             ( attributes.value( "rel" ).toLower() == "stylesheet" ) &&
+             attributes.contains( "href" ) )
+        {
+            linked_css_paths.append( attributes.value( "href" ) );
+        }
+    }
+
+    return linked_css_paths;
+}
+
+
 void XhtmlDoc::RemoveChildren( xc::DOMNode &node )
 {
     while ( true )
@@ -99,8 +99,15 @@ public:
     /**
      * Parses the source text into a DOM and returns a shared pointer
      * to the heap-created document. 
+     *
+     * @param source The XHTML source.
+     * @param track_locations Whether element line and column numbers
+     *                        should be recorded. NodeLineNumber() and
+     *                        NodeColumnNumber() only work on documents 
+     *                        loaded with this set.
      */
-    static boost::shared_ptr< xc::DOMDocument > LoadTextIntoDocument( const QString &source );
+    static boost::shared_ptr< xc::DOMDocument > LoadTextIntoDocument( const QString &source, 
+                                                                      bool track_locations = false );
 
     static boost::shared_ptr< xc::DOMDocument > CopyDomDocument( const xc::DOMDocument &document );
 
@@ -165,6 +172,10 @@ public:
     // Return a list of all linked CSS stylesheets
     static QStringList GetLinkedStylesheets( const QString &source );
 
+    // Like GetLinkedStylesheets( const QString& ),
+    // but for an already loaded document
+    static QStringList GetLinkedStylesheets( const xc::DOMDocument &document );
+
     // Returns the node's "real" name. We don't care
     // about namespace prefixes and whatnot.
     static QString GetNodeName( const xc::DOMNode &node );
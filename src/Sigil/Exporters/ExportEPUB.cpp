@@ -24,12 +24,14 @@
 #include <iowin32.h>
 #endif
 
+#include <QtCore/QBuffer>
 #include <QtCore/QDir>
 #include <QtCore/QDirIterator>
 #include <QtCore/QFile>
 #include <QtCore/QFileInfo>
-#include <QtCore/QTemporaryFile>
+#include <QtCore/QFuture>
 #include <QtCore/QTextStream>
+#include <QtCore/QtConcurrentMap>
 
 #include "BookManipulation/CleanSource.h"
 #include "BookManipulation/FolderKeeper.h"
@@ -37,9 +39,9 @@
 #include "Exporters/EncryptionXmlWriter.h"
 #include "Exporters/ExportEPUB.h"
 #include "Misc/Utility.h"
-#include "Misc/TempFolder.h"
 #include "Misc/FontObfuscation.h"
 #include "ResourceObjects/FontResource.h"
+#include "ResourceObjects/TextResource.h"
 #include "sigil_constants.h"
 #include "sigil_exception.h"
 
@@ -58,6 +60,10 @@ static const QString OEBPS_FOLDER_SUFFIX   = "/OEBPS";
 
 static const QString EPUB_MIME_TYPE = "application/epub+zip";
 
+// Images in these formats are already compressed,
+// so we store them in the archive as they are.
+static const QStringList COMPRESSED_IMAGE_EXTENSIONS = QStringList() << "jpg" << "jpeg" << "png" << "gif";
+
 
 // Constructor;
 // the first parameter is the location where the book 
@@ -91,32 +97,20 @@ void ExportEPUB::WriteBook()
     m_Book->GetOPF().AddModificationDateMeta();
     m_Book->SaveAllResourcesToDisk();
 
-    TempFolder tempfolder;
-    CreatePublication( tempfolder.GetPath() );
-
-    if ( m_Book->HasObfuscatedFonts() )
-
-        ObfuscateFonts( tempfolder.GetPath() );
-
-    SaveFolderAsEpubToLocation( tempfolder.GetPath(), m_FullFilePath );
+    // The archive is written straight from the book's folder
+    // and resources, so we don't need a copy of the book on disk.
+    SaveFolderAsEpubToLocation( m_Book->GetFolderKeeper().GetFullPathToMainFolder(), m_FullFilePath );
 }
 
 
-// Creates the publication from the Book
-// (creates XHTML, CSS, OPF, NCX files etc.)
-void ExportEPUB::CreatePublication( const QString &fullfolderpath )
-{
-    Utility::CopyFiles( m_Book->GetFolderKeeper().GetFullPathToMainFolder(), fullfolderpath );
-
-    if ( m_Book->HasObfuscatedFonts() )
-        
-        CreateEncryptionXML( fullfolderpath + METAINF_FOLDER_SUFFIX );
-}
-
 void ExportEPUB::SaveFolderAsEpubToLocation( const QString &fullfolderpath, const QString &fullfilepath )
 {
     QString tempFile = fullfolderpath + "-tmp.epub";
 
+    // Building the entries can throw (obfuscated fonts are read
+    // and obfuscated here), so it's done before the archive is created.
+    const QList< ArchiveEntry > &entries = GetArchiveEntries(fullfolderpath);
+
 #ifdef Q_OS_WIN32
     zlib_filefunc64_def ffunc;
     fill_win32_filefunc64W(&ffunc);
@@ -135,8 +129,8 @@ void ExportEPUB::SaveFolderAsEpubToLocation( const QString &fullfolderpath, cons
         QFile::remove(tempFile);
         boost_throw(CannotStoreFile() << errinfo_file_fullpath("mimetype"));
     }
-    const char *mime_data = EPUB_MIME_TYPE.toUtf8().constData();
-    if (zipWriteInFileInZip(zfile, mime_data, (unsigned int)strlen(mime_data)) != Z_OK) {
+    QByteArray mime_data = EPUB_MIME_TYPE.toUtf8();
+    if (zipWriteInFileInZip(zfile, mime_data.constData(), (unsigned int)mime_data.size()) != Z_OK) {
         zipCloseFileInZip(zfile);
         zipClose(zfile, NULL);
         QFile::remove(tempFile);
@@ -144,57 +138,70 @@ void ExportEPUB::SaveFolderAsEpubToLocation( const QString &fullfolderpath, cons
     }
     zipCloseFileInZip(zfile);
 
-    // Write all the files in our directory path to the archive.
-    QDirIterator it(fullfolderpath, QDir::Files|QDir::NoDotAndDotDot|QDir::Readable|QDir::Hidden, QDirIterator::Subdirectories);
-    while (it.hasNext()) {
-        it.next();
-        QString relpath = it.filePath().remove(fullfolderpath);
-        while (relpath.startsWith("/")) {
-            relpath = relpath.remove(0, 1);
-        }
+    // The files are read and deflated on the thread pool, and written
+    // to the archive here in their original order as the results come in.
+    QFuture< ArchiveEntry > future = QtConcurrent::mapped(entries, CompressEntry);
 
-        // Add the file entry to the archive.
-        // We should check the uncompressed file size. If it's over >= 0xffffffff the last parameter (zip64) should be 1.
-        if (zipOpenNewFileInZip4_64(zfile, relpath.toUtf8().constData(), NULL, NULL, 0, NULL, 0, NULL, Z_DEFLATED, 8, 0, 15, 8, Z_DEFAULT_STRATEGY, NULL, 0, 0x0b00, 0, 0) != Z_OK) {
+    for (int i = 0; i < entries.count(); ++i) {
+        // Blocks until this entry has been processed.
+        const ArchiveEntry &entry = future.resultAt(i);
+        QByteArray relpath = entry.relative_path.toUtf8();
+
+        if (entry.read_error) {
+            future.waitForFinished();
             zipClose(zfile, NULL);
             QFile::remove(tempFile);
-            boost_throw(CannotStoreFile() << errinfo_file_fullpath(relpath.toStdString()));
+            boost_throw(CannotOpenFile() << errinfo_file_fullpath(entry.fullfilepath.toStdString()));
         }
 
-        // Open the file on disk. We will read this and write what we read into
-        // the archive.
-        QFile dfile(it.filePath());
-        if (!dfile.open(QIODevice::ReadOnly)) {
-            zipCloseFileInZip(zfile);
+        // Compressed entries are written as raw deflate data; minizip
+        // only needs to be told the original size and the CRC.
+        // We should check the uncompressed file size. If it's over >= 0xffffffff the last parameter (zip64) should be 1.
+        int method = entry.store ? 0 : Z_DEFLATED;
+        int level  = entry.store ? 0 : 8;
+        int raw    = entry.store ? 0 : 1;
+
+        if (zipOpenNewFileInZip4_64(zfile, relpath.constData(), NULL, NULL, 0, NULL, 0, NULL, method, level, raw, 15, 8, Z_DEFAULT_STRATEGY, NULL, 0, 0x0b00, 0, 0) != Z_OK) {
+            future.waitForFinished();
             zipClose(zfile, NULL);
             QFile::remove(tempFile);
-            boost_throw(CannotOpenFile() << errinfo_file_fullpath(it.fileName().toStdString()));
+            boost_throw(CannotStoreFile() << errinfo_file_fullpath(entry.relative_path.toStdString()));
+        }
+
+        bool written = true;
+
+        if (entry.in_memory) {
+            written = entry.data.isEmpty() ||
+                      zipWriteInFileInZip(zfile, entry.data.constData(), (unsigned int)entry.data.size()) == Z_OK;
         }
-        // Write the data from the file on disk into the archive.
-        char buff[BUFF_SIZE] = {0};
-        qint64 read = 0;
-        while ((read = dfile.read(buff, BUFF_SIZE)) > 0) {
-            if (zipWriteInFileInZip(zfile, buff, read) != Z_OK) {
-                dfile.close();
+        else {
+            // Already compressed files are streamed from disk
+            // so that they don't all end up in memory.
+            QFile dfile(entry.fullfilepath);
+            if (!dfile.open(QIODevice::ReadOnly)) {
+                future.waitForFinished();
                 zipCloseFileInZip(zfile);
                 zipClose(zfile, NULL);
                 QFile::remove(tempFile);
-                boost_throw(CannotStoreFile() << errinfo_file_fullpath(relpath.toStdString()));
+                boost_throw(CannotOpenFile() << errinfo_file_fullpath(entry.fullfilepath.toStdString()));
             }
+            char buff[BUFF_SIZE] = {0};
+            qint64 read = 0;
+            while (written && (read = dfile.read(buff, BUFF_SIZE)) > 0) {
+                written = zipWriteInFileInZip(zfile, buff, read) == Z_OK;
+            }
+            dfile.close();
+            // There was an error reading the file on disk.
+            written = written && read >= 0;
         }
-        dfile.close();
-        // There was an error reading the file on disk.
-        if (read < 0) {
-            zipCloseFileInZip(zfile);
-            zipClose(zfile, NULL);
-            QFile::remove(tempFile);
-            boost_throw(CannotStoreFile() << errinfo_file_fullpath(relpath.toStdString()));
-        }
 
-        if (zipCloseFileInZip(zfile) != Z_OK) {
+        int closed = entry.store ? zipCloseFileInZip(zfile) : zipCloseFileInZipRaw64(zfile, entry.uncompressed_size, entry.crc);
+
+        if (!written || closed != Z_OK) {
+            future.waitForFinished();
             zipClose(zfile, NULL);
             QFile::remove(tempFile);
-            boost_throw(CannotStoreFile() << errinfo_file_fullpath(relpath.toStdString()));
+            boost_throw(CannotStoreFile() << errinfo_file_fullpath(entry.relative_path.toStdString()));
         }
     }
 
@@ -210,57 +217,200 @@ void ExportEPUB::SaveFolderAsEpubToLocation( const QString &fullfolderpath, cons
 }
 
 
-void ExportEPUB::CreateEncryptionXML( const QString &fullfolderpath )
+QList< ExportEPUB::ArchiveEntry > ExportEPUB::GetArchiveEntries( const QString &fullfolderpath ) const
 {
-    QTemporaryFile file;
+    QList< ArchiveEntry > entries;
+
+    QDir folder( fullfolderpath );
+    QHash< QString, Resource* > resources;
 
-    if ( !file.open() )
+    foreach( Resource *resource, m_Book->GetFolderKeeper().GetResourceList() )
     {
-        boost_throw( CannotOpenFile() 
-                     << errinfo_file_fullpath( file.fileName().toStdString() )
-                     << errinfo_file_errorstring( file.errorString().toStdString() ) 
-                   );
+        resources[ folder.relativeFilePath( resource->GetFullPath() ) ] = resource;
     }
-    
-    EncryptionXmlWriter enc( *m_Book, file );
-    enc.WriteXML();
 
-    // Write to disk immediately
-    file.flush();
+    bool has_obfuscated_fonts = m_Book->HasObfuscatedFonts();
+    QString encryption_xml_path = METAINF_FOLDER_SUFFIX.mid( 1 ) + "/" + ENCRYPTION_XML_FILE_NAME;
+    QString uuid_id;
+    QString main_id;
+
+    if ( has_obfuscated_fonts )
+    {
+        uuid_id = m_Book->GetOPF().GetUUIDIdentifierValue();   
+        main_id = m_Book->GetPublicationIdentifier();
+    }
+
+    QDirIterator it(fullfolderpath, QDir::Files|QDir::NoDotAndDotDot|QDir::Readable|QDir::Hidden, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        it.next();
+        QString relpath = it.filePath().remove(fullfolderpath);
+        while (relpath.startsWith("/")) {
+            relpath = relpath.remove(0, 1);
+        }
 
-    QFile::copy( file.fileName(), fullfolderpath + "/" + ENCRYPTION_XML_FILE_NAME ); 
+        // A new one is written below
+        if (has_obfuscated_fonts && relpath == encryption_xml_path) {
+            continue;
+        }
+
+        ArchiveEntry entry;
+        entry.fullfilepath  = it.filePath();
+        entry.relative_path = relpath;
+
+        Resource *resource          = resources.value(relpath, NULL);
+        TextResource *text_resource = qobject_cast< TextResource* >(resource);
+        FontResource *font_resource = qobject_cast< FontResource* >(resource);
+
+        if (text_resource) {
+            // The resources have just been saved, so the
+            // text in memory is the same as the text on disk.
+            entry.data      = text_resource->GetText().toUtf8();
+            entry.in_memory = true;
+        }
+        else if (font_resource && !font_resource->GetObfuscationAlgorithm().isEmpty()) {
+            entry.data      = GetObfuscatedFontData(*font_resource, uuid_id, main_id);
+            entry.in_memory = true;
+        }
+        else {
+            entry.store = IsAlreadyCompressed(relpath, resource);
+        }
+
+        entries.append(entry);
+    }
+
+    if (has_obfuscated_fonts) {
+        ArchiveEntry entry;
+        entry.fullfilepath  = fullfolderpath + "/" + encryption_xml_path;
+        entry.relative_path = encryption_xml_path;
+        entry.data          = CreateEncryptionXML();
+        entry.in_memory     = true;
+
+        entries.append(entry);
+    }
+
+    return entries;
 }
 
 
-void ExportEPUB::ObfuscateFonts( const QString &fullfolderpath )
+bool ExportEPUB::IsAlreadyCompressed( const QString &relative_path, const Resource *resource )
 {
-    QString uuid_id = m_Book->GetOPF().GetUUIDIdentifierValue();   
-    QString main_id = m_Book->GetPublicationIdentifier();
+    QString extension = QFileInfo( relative_path ).suffix().toLower();
 
-    QList< FontResource* > font_resources = m_Book->GetFolderKeeper().GetResourceTypeList< FontResource >();
+    // WOFF fonts end up as Misc resources
+    if ( extension == "woff" )
 
-    foreach( FontResource *font_resource, font_resources )
+        return true;
+
+    return resource                                          &&
+           resource->Type() == Resource::ImageResourceType   &&
+           COMPRESSED_IMAGE_EXTENSIONS.contains( extension );
+}
+
+
+ExportEPUB::ArchiveEntry ExportEPUB::CompressEntry( const ArchiveEntry &entry )
+{
+    ArchiveEntry compressed = entry;
+
+    if ( !compressed.in_memory )
     {
-        QString algorithm = font_resource->GetObfuscationAlgorithm();
+        // Stored files are streamed from disk by the archive writer
+        if ( compressed.store )
 
-        if ( algorithm.isEmpty() )
+            return compressed;
 
-            continue;
+        QFile file( compressed.fullfilepath );
+
+        if ( !file.open( QIODevice::ReadOnly ) )
+        {
+            compressed.read_error = true;
+            return compressed;
+        }
+
+        compressed.data      = file.readAll();
+        compressed.in_memory = true;
+    }
+
+    QByteArray data = compressed.data;
 
-        QString font_path = fullfolderpath + "/" + font_resource->GetRelativePathToRoot();
+    if ( compressed.store )
 
-        if ( algorithm == ADOBE_FONT_ALGO_ID )
+        return compressed;
 
-            FontObfuscation::ObfuscateFile( font_path, algorithm, uuid_id );
+    compressed.uncompressed_size = data.size();
+    compressed.crc               = crc32( 0, (const Bytef*) data.constData(), data.size() );
 
-        else 
+    z_stream stream;
+    memset( &stream, 0, sizeof( stream ) );
 
-            FontObfuscation::ObfuscateFile( font_path, algorithm, main_id );
-    }    
+    // Negative window bits give us raw deflate data with no zlib
+    // header, which is what goes into a zip archive.
+    if ( deflateInit2( &stream, 8, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY ) != Z_OK )
+    {
+        compressed.store = true;
+        compressed.data  = data;
+        return compressed;
+    }
+
+    QByteArray deflated;
+    deflated.resize( deflateBound( &stream, data.size() ) );
+
+    stream.next_in   = (Bytef*) data.constData();
+    stream.avail_in  = data.size();
+    stream.next_out  = (Bytef*) deflated.data();
+    stream.avail_out = deflated.size();
+
+    int result = deflate( &stream, Z_FINISH );
+    deflated.resize( stream.total_out );
+    deflateEnd( &stream );
+
+    // Data that doesn't shrink (e.g. media we don't know
+    // to be compressed already) is stored as is.
+    if ( result != Z_STREAM_END || deflated.size() >= data.size() )
+    {
+        compressed.store = true;
+        compressed.data  = data;
+        return compressed;
+    }
+
+    compressed.data = deflated;
+    return compressed;
 }
 
 
+QByteArray ExportEPUB::CreateEncryptionXML() const
+{
+    QByteArray xml;
+    QBuffer buffer( &xml );
+    buffer.open( QIODevice::WriteOnly );
+
+    {
+        EncryptionXmlWriter enc( *m_Book, buffer );
+        enc.WriteXML();
+    }
+
+    buffer.close();
+    return xml;
+}
+
 
+QByteArray ExportEPUB::GetObfuscatedFontData( const FontResource &font_resource, 
+                                              const QString &uuid_id, 
+                                              const QString &main_id )
+{
+    QFile file( font_resource.GetFullPath() );
 
+    if ( !file.open( QIODevice::ReadOnly ) )
+    {
+        boost_throw( CannotOpenFile() 
+                     << errinfo_file_fullpath( file.fileName().toStdString() )
+                     << errinfo_file_errorstring( file.errorString().toStdString() ) 
+                   );
+    }
 
+    QString algorithm = font_resource.GetObfuscationAlgorithm();
 
+    return FontObfuscation::ObfuscateData( file.readAll(), 
+                                           algorithm, 
+                                           algorithm == ADOBE_FONT_ALGO_ID ? uuid_id : main_id,
+                                           font_resource.GetFullPath() );
+}
@@ -23,6 +23,9 @@
 #ifndef EXPORTEPUB_H
 #define EXPORTEPUB_H
 
+#include <QtCore/QByteArray>
+#include <QtCore/QList>
+
 #include "BookManipulation/FolderKeeper.h"
 #include "BookManipulation/Book.h"
 #include "Exporters/Exporter.h"
@@ -46,9 +49,35 @@ public:
 
 private:
 
-    // Creates the publication from the Book
-    // (creates XHTML, CSS, OPF, NCX files etc.)
-    void virtual CreatePublication( const QString &fullfolderpath );
+    // A file to be added to the archive. Entries are read
+    // and compressed in parallel ahead of being written.
+    struct ArchiveEntry
+    {
+        // The full path to the file on disk
+        QString fullfilepath;
+
+        // The path of the file inside the archive
+        QString relative_path;
+
+        // True if the file should be stored uncompressed
+        bool store;
+
+        // True if the data member holds the file contents;
+        // once compressed, that's raw deflate data unless
+        // the entry is stored
+        bool in_memory;
+
+        // True if the file could not be read
+        bool read_error;
+
+        QByteArray data;
+
+        quint32 crc;
+
+        qint64 uncompressed_size;
+
+        ArchiveEntry() : store( false ), in_memory( false ), read_error( false ), crc( 0 ), uncompressed_size( 0 ) {}
+    };
 
     // Saves the publication in the specified folder 
     // to the specified file path as an epub;
@@ -56,12 +85,30 @@ private:
     // mimetype to write to the special "mimetype" file
     void SaveFolderAsEpubToLocation( const QString &fullfolderpath, const QString &fullfilepath );
 
-    // Creates the publication's encryption.xml file,
-    // if there are any fonts to obfuscate
-    void CreateEncryptionXML( const QString &fullfolderpath );
-
-    // Obfuscates the fonts marked for obfuscation
-    void ObfuscateFonts( const QString &fullfolderpath );
+    // Returns the entries for all the files in the specified
+    // folder, in the order they should be archived; text resources
+    // and obfuscated fonts are provided from memory
+    QList< ArchiveEntry > GetArchiveEntries( const QString &fullfolderpath ) const;
+
+    // Returns true if the data of the file is already compressed
+    // (JPEG, PNG, GIF, WOFF) and deflating it would be wasted effort;
+    // the resource of the file can be NULL
+    static bool IsAlreadyCompressed( const QString &relative_path, const Resource *resource );
+
+    // Reads and deflates the file of the entry; files that
+    // don't shrink are marked to be stored instead
+    static ArchiveEntry CompressEntry( const ArchiveEntry &entry );
+
+    // Returns the publication's encryption.xml file,
+    // for when there are fonts to obfuscate
+    QByteArray CreateEncryptionXML() const;
+
+    // Returns the data of the font obfuscated with its algorithm;
+    // the key is derived from the UUID identifier for the Adobe
+    // algorithm and from the main identifier for the IDPF one
+    static QByteArray GetObfuscatedFontData( const FontResource &font_resource, 
+                                             const QString &uuid_id, 
+                                             const QString &main_id );
 
 
     ///////////////////////////////
@@ -160,7 +160,9 @@ void ImportHTML::UpdateFiles( HTMLResource &html_resource,
     sync.addFuture( QtConcurrent::map( css_resources, 
         boost::bind( UniversalUpdates::LoadAndUpdateOneCSSFile, _1, css_updates ) ) );
 
-    html_resource.SetText(XhtmlDoc::GetDomDocumentAsString(*PerformHTMLUpdates( document, html_updates, css_updates )().get()));
+    shared_ptr< xc::DOMDocument > updated_document = PerformHTMLUpdates( document, html_updates, css_updates )();
+    html_resource.SetUpdatedText( XhtmlDoc::GetDomDocumentAsString( *updated_document.get() ),
+                                  HTMLResource::GetPathsToLinkedResources( *updated_document.get() ) );
 
     sync.waitForFinished();
 }
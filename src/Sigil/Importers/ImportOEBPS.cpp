@@ -25,6 +25,7 @@
 #endif
 
 #include <QtCore/QtCore>
+#include <QtCore/QBuffer>
 #include <QtCore/QFileInfo>
 #include <QtCore/QFutureSynchronizer>
 #include <QtGui/QMessageBox>
@@ -55,6 +56,43 @@ static const QString UPDATE_ERROR_STRING = "SG_ERROR";
 const QString NCX_MIMETYPE               = "application/x-dtbncx+xml";
 static const QString NCX_EXTENSION       = "ncx";
 
+static unzFile OpenContainer( const QString &fullfilepath )
+{
+#ifdef Q_OS_WIN32
+    zlib_filefunc64_def ffunc;
+    fill_win32_filefunc64W(&ffunc);
+    return unzOpen2_64(QDir::toNativeSeparators(fullfilepath).toStdWString().c_str(), &ffunc);
+#else
+    return unzOpen64(QDir::toNativeSeparators(fullfilepath).toUtf8().constData());
+#endif
+}
+
+
+// Inflates the current file of the archive into the device
+static bool InflateCurrentFile( unzFile zfile, QIODevice &device )
+{
+    if (unzOpenCurrentFile(zfile) != UNZ_OK) {
+        return false;
+    }
+
+    // Buffered reading and writing.
+    char buff[BUFF_SIZE] = {0};
+    int read = 0;
+    bool written = true;
+    while ((read = unzReadCurrentFile(zfile, buff, BUFF_SIZE)) > 0) {
+        written = written && device.write(buff, read) == read;
+    }
+
+    // Read errors are marked by a negative read amount, and if the file 
+    // was read but the CRC did not match, closing it reports that.
+    // We don't check the read file size vs the uncompressed file size
+    // because if they're different there should be a CRC error.
+    bool crc_ok = unzCloseCurrentFile(zfile) != UNZ_CRCERROR;
+
+    return written && read >= 0 && crc_ok;
+}
+
+
 ImportOEBPS::ImportOEBPS( const QString &fullfilepath )
     :
     Importer( fullfilepath ),
@@ -64,22 +102,20 @@ ImportOEBPS::ImportOEBPS( const QString &fullfilepath )
 }
 
 
+// Only the META-INF files are extracted here. The OPF and NCX are extracted
+// once we know where they are, and the content files are inflated straight
+// into the book folder by LoadFolderStructure().
 void ImportOEBPS::ExtractContainer()
 {
     int res = 0;
-#ifdef Q_OS_WIN32
-    zlib_filefunc64_def ffunc;
-    fill_win32_filefunc64W(&ffunc);
-    unzFile zfile = unzOpen2_64(QDir::toNativeSeparators(m_FullFilePath).toStdWString().c_str(), &ffunc);
-#else
-    unzFile zfile = unzOpen64(QDir::toNativeSeparators(m_FullFilePath).toUtf8().constData());
-#endif
+    unzFile zfile = OpenContainer(m_FullFilePath);
 
     if (zfile == NULL) {
         boost_throw(CannotOpenFile() << errinfo_file_fullpath(m_FullFilePath.toStdString()));
     }
 
-    while ((res = unzGoToNextFile(zfile)) == UNZ_OK) {
+    res = unzGoToFirstFile(zfile);
+    while (res == UNZ_OK) {
         // Get the name of the file in the archive.
         char file_name[MAX_PATH] = {0};
         unz_file_info64 file_info;
@@ -87,58 +123,35 @@ void ImportOEBPS::ExtractContainer()
         QString qfile_name = QString::fromUtf8(file_name);
 
         // If there is no file name then we can't do anything with it.
-        if (!qfile_name.isEmpty()) {
-            // We use the dir object to create the path in the temporary directory.
-            // Unfortunately, we need a dir ojbect to do this as it's not a static function.
-            QDir dir(m_ExtractedFolderPath);
-            // Full file path in the temporary directory.
-            QString file_path = m_ExtractedFolderPath + "/" + qfile_name;
-            QFileInfo qfile_info(file_path);
-
-            // Is this entry a directory?
-            if (file_info.uncompressed_size == 0 && qfile_name.endsWith('/')) {
-                dir.mkpath(qfile_name);
-                continue;
-            } else {
-                dir.mkpath(qfile_info.path());
-            }
-
-            // Open the file entry in the archive for reading.
-            if (unzOpenCurrentFile(zfile) != UNZ_OK) {
-                unzClose(zfile);
-                boost_throw(CannotExtractFile() << errinfo_file_fullpath(qfile_name.toStdString()));
-            }
-
-            // Open the file on disk to write the entry in the archive to.
-            QFile entry(file_path);
-            if (!entry.open(QIODevice::WriteOnly|QIODevice::Truncate)) {
-                unzCloseCurrentFile(zfile);
-                unzClose(zfile);
-                boost_throw(CannotExtractFile() << errinfo_file_fullpath(qfile_name.toStdString()));
-            }
-
-            // Buffered reading and writing.
-            char buff[BUFF_SIZE] = {0};
-            int read = 0;
-            while ((read = unzReadCurrentFile(zfile, buff, BUFF_SIZE)) > 0) {
-                entry.write(buff, read);
-            }
-            entry.close();
-            // Read errors are marked by a negative read amount.
-            if (read < 0) {
-                unzCloseCurrentFile(zfile);
-                unzClose(zfile);
-                boost_throw(CannotExtractFile() << errinfo_file_fullpath(qfile_name.toStdString()));
+        // Directories are created as needed.
+        if (!qfile_name.isEmpty() && !(file_info.uncompressed_size == 0 && qfile_name.endsWith('/'))) {
+            unz64_file_pos file_pos;
+            unzGetFilePos64(zfile, &file_pos);
+
+            ContainerEntryPosition position;
+            position.pos_in_zip_directory = file_pos.pos_in_zip_directory;
+            position.num_of_file          = file_pos.num_of_file;
+            m_ContainerEntries[qfile_name] = position;
+
+            if (!m_LowercaseContainerEntryNames.contains(qfile_name.toLower())) {
+                m_LowercaseContainerEntryNames[qfile_name.toLower()] = qfile_name;
             }
 
-            // The file was read but the CRC did not match.
-            // We don't check the read file size vs the uncompressed file size
-            // because if they're different there should be a CRC error.
-            if (unzCloseCurrentFile(zfile) == UNZ_CRCERROR) {
-                unzClose(zfile);
-                boost_throw(CannotExtractFile() << errinfo_file_fullpath(qfile_name.toStdString()));
+            if (qfile_name.startsWith("META-INF/")) {
+                // Full file path in the temporary directory.
+                QString file_path = m_ExtractedFolderPath + "/" + qfile_name;
+                QDir(m_ExtractedFolderPath).mkpath(QFileInfo(file_path).path());
+
+                // Open the file on disk to write the entry in the archive to.
+                QFile entry(file_path);
+                if (!entry.open(QIODevice::WriteOnly|QIODevice::Truncate) || !InflateCurrentFile(zfile, entry)) {
+                    unzClose(zfile);
+                    boost_throw(CannotExtractFile() << errinfo_file_fullpath(qfile_name.toStdString()));
+                }
             }
         }
+
+        res = unzGoToNextFile(zfile);
     }
     if (res != UNZ_END_OF_LIST_OF_FILE) {
         unzClose(zfile);
@@ -149,6 +162,85 @@ void ImportOEBPS::ExtractContainer()
 }
 
 
+void ImportOEBPS::ExtractFileFromContainer( const QString &fullfilepath )
+{
+    if ( QFileInfo( fullfilepath ).exists() )
+
+        return;
+
+    QByteArray data;
+
+    if ( !ReadFileFromContainer( fullfilepath, data ) )
+
+        return;
+
+    QDir( m_ExtractedFolderPath ).mkpath( QFileInfo( fullfilepath ).absolutePath() );
+
+    QFile file( fullfilepath );
+
+    if ( !file.open( QIODevice::WriteOnly | QIODevice::Truncate ) || file.write( data ) != data.size() )
+
+        boost_throw( CannotExtractFile() << errinfo_file_fullpath( fullfilepath.toStdString() ) );
+}
+
+
+bool ImportOEBPS::ReadFileFromContainer( const QString &fullfilepath, QByteArray &data ) const
+{
+    QString entry_name = GetContainerEntryName( fullfilepath );
+
+    if ( entry_name.isEmpty() )
+
+        return false;
+
+    // minizip handles can't be shared between threads,
+    // so every read gets its own.
+    unzFile zfile = OpenContainer( m_FullFilePath );
+
+    if ( zfile == NULL )
+
+        boost_throw( CannotOpenFile() << errinfo_file_fullpath( m_FullFilePath.toStdString() ) );
+
+    const ContainerEntryPosition &position = m_ContainerEntries[ entry_name ];
+
+    unz64_file_pos file_pos;
+    file_pos.pos_in_zip_directory = position.pos_in_zip_directory;
+    file_pos.num_of_file          = position.num_of_file;
+
+    QBuffer buffer( &data );
+    buffer.open( QIODevice::WriteOnly );
+
+    bool inflated = unzGoToFilePos64( zfile, &file_pos ) == UNZ_OK && InflateCurrentFile( zfile, buffer );
+    unzClose( zfile );
+
+    if ( !inflated )
+
+        boost_throw( CannotExtractFile() << errinfo_file_fullpath( entry_name.toStdString() ) );
+
+    return true;
+}
+
+
+QString ImportOEBPS::GetContainerEntryName( const QString &fullfilepath ) const
+{
+    QString path   = QDir::cleanPath( fullfilepath );
+    QString prefix = QDir::cleanPath( m_ExtractedFolderPath ) + "/";
+
+    if ( !path.startsWith( prefix ) )
+
+        return QString();
+
+    QString entry_name = path.mid( prefix.length() );
+
+    if ( m_ContainerEntries.contains( entry_name ) )
+
+        return entry_name;
+
+    // The files used to be read from the extracted folder, 
+    // and on Windows and Mac file names are case insensitive.
+    return m_LowercaseContainerEntryNames.value( entry_name.toLower() );
+}
+
+
 void ImportOEBPS::LocateOPF()
 {
     QString fullpath = m_ExtractedFolderPath + "/META-INF/container.xml";
@@ -167,6 +259,7 @@ void ImportOEBPS::LocateOPF()
                )
             {
                 m_OPFFilePath = m_ExtractedFolderPath + "/" + container.attributes().value( "", "full-path" ).toString();
+                ExtractFileFromContainer( m_OPFFilePath );
 
                 // As per OCF spec, the first rootfile element
                 // with the OEBPS mimetype is considered the "main" one.
@@ -393,6 +486,8 @@ QString ImportOEBPS::GetNCXId()
 
 void ImportOEBPS::LoadInfrastructureFiles()
 {
+    ExtractFileFromContainer( m_NCXFilePath );
+
     m_Book->GetOPF().SetText( PrepareOPFForReading( Utility::ReadUnicodeTextFile( m_OPFFilePath ) ) );
     m_Book->GetNCX().SetText( Utility::ReadUnicodeTextFile( m_NCXFilePath ) );
 }
@@ -425,6 +520,11 @@ QHash< QString, QString > ImportOEBPS::LoadFolderStructure()
     for ( int i = 0; i < num_futures; ++i )
     {
         tuple< QString, QString > result = futures.at( i ).result();
+
+        if ( result.get< 1 >() == UPDATE_ERROR_STRING && result.get< 0 >() != UPDATE_ERROR_STRING )
+
+            boost_throw( CannotExtractFile() << errinfo_file_fullpath( result.get< 0 >().toStdString() ) );
+
         updates[ result.get< 0 >() ] = result.get< 1 >();
     }
 
@@ -440,7 +540,14 @@ tuple< QString, QString > ImportOEBPS::LoadOneFile( const QString &path,
 
     try
     {
-        Resource &resource = m_Book->GetFolderKeeper().AddContentFileToFolder( fullfilepath, false, mimetype );
+        QByteArray data;
+        FolderKeeper &folder_keeper = m_Book->GetFolderKeeper();
+
+        // Files are inflated straight into their place in the book folder.
+        Resource &resource = ReadFileFromContainer( fullfilepath, data )                     ?
+                             folder_keeper.AddContentToFolder( fullfilepath, data, false, mimetype ) :
+                             folder_keeper.AddContentFileToFolder( fullfilepath, false, mimetype );
+
         QString newpath = "../" + resource.GetRelativePathToOEBPS(); 
 
         return make_tuple( fullfilepath, newpath );
@@ -450,6 +557,12 @@ tuple< QString, QString > ImportOEBPS::LoadOneFile( const QString &path,
     {
     	return make_tuple( UPDATE_ERROR_STRING, UPDATE_ERROR_STRING );
     }
+
+    // We're on a worker thread, so we let LoadFolderStructure() report this
+    catch ( ExceptionBase& )
+    {
+        return make_tuple( fullfilepath, UPDATE_ERROR_STRING );
+    }
 }
 
 
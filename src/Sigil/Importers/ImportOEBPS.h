@@ -59,12 +59,41 @@ public:
 protected:
     
     /**
-     * Extracts the EPUB file to a temporary folder.
-     * The path to the the temp folder with the extracted files
-     * is stored in m_ExtractedFolderPath.
+     * Reads the list of files in the EPUB and extracts the META-INF files
+     * to a temporary folder. The path to the the temp folder with the
+     * extracted files is stored in m_ExtractedFolderPath.
+     * Other files are extracted on demand with ExtractFileFromContainer()
+     * or read straight into memory with ReadFileFromContainer().
      */
     void ExtractContainer();
 
+    /**
+     * Extracts a single file of the EPUB to its place in the
+     * temp folder, unless it's already there.
+     *
+     * @param fullfilepath The full path of the file in the temp folder.
+     */
+    void ExtractFileFromContainer( const QString &fullfilepath );
+
+    /**
+     * Inflates a single file of the EPUB into memory.
+     * Can be called from several threads at once.
+     *
+     * @param fullfilepath The full path the file would have in the temp folder.
+     * @param data Set to the contents of the file.
+     * @return \c false if the EPUB has no such file.
+     */
+    bool ReadFileFromContainer( const QString &fullfilepath, QByteArray &data ) const;
+
+    /**
+     * Returns the name of the EPUB entry that would be extracted to
+     * the specified path in the temp folder.
+     *
+     * @param fullfilepath The full path of the file in the temp folder.
+     * @return The name of the entry, or an empty string if there is none.
+     */
+    QString GetContainerEntryName( const QString &fullfilepath ) const;
+
     /**
      * Locates the OPF file in the extracted folder.
      * The path to the OPF is then stored in m_OPFFilePath.
@@ -211,6 +240,29 @@ protected:
      * This hash stores all the candidates, as an ID-to-href mapping.
      */
     QHash< QString, QString > m_NcxCandidates;
+
+    /**
+     * The location of an entry in the EPUB file,
+     * as used by minizip's unzGoToFilePos64.
+     */
+    struct ContainerEntryPosition
+    {
+        quint64 pos_in_zip_directory;
+        quint64 num_of_file;
+    };
+
+    /**
+     * The files in the EPUB; the keys are the
+     * entry names, the values their locations.
+     */
+    QHash< QString, ContainerEntryPosition > m_ContainerEntries;
+
+    /**
+     * Lowercased entry names mapped to the entry names. 
+     * Used to match manifest paths that differ from the 
+     * entry names only in case.
+     */
+    QHash< QString, QString > m_LowercaseContainerEntryNames;
 };
 
 
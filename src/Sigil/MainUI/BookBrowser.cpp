@@ -283,6 +283,22 @@ QList <Resource *> BookBrowser::AllCSSResources()
     return m_OPFModel.GetResourceListInFolder( Resource::CSSResourceType );
 }
 
+QList <Resource *> BookBrowser::AllTextResources()
+{
+    QList <Resource *> resources = AllHTMLResources() + AllCSSResources();
+
+    // The Misc folder holds text and XML files, but also others
+    foreach ( Resource *resource, m_OPFModel.GetResourceListInFolder( Resource::TextResourceType ) )
+    {
+        if ( qobject_cast< TextResource* >( resource ) )
+        {
+            resources.append( resource );
+        }
+    }
+
+    return resources;
+}
+
 QList <Resource *> BookBrowser::ValidSelectedResources( Resource::ResourceType resource_type )
 {
     QList <Resource *> resources = ValidSelectedResources();
@@ -769,27 +785,19 @@ void BookBrowser::RenameSelected()
         extension = first_filename.right( first_filename.length() - first_filename.lastIndexOf( '.' ) );
     }
 
-    // Display progress dialog
-    QProgressDialog progress(QObject::tr( "Renaming Files.." ), QString(), 0, resources.count(), this);
-    progress.setMinimumDuration(PROGRESS_BAR_MINIMUM_DURATION);
-    int progress_value = 0;
-
-    // Rename each entry in turn
+    // Name each entry in turn; the files are all renamed
+    // together so the book is only updated once
+    QHash< Resource*, QString > new_filenames;
     int i = templateNumber.toInt();
     foreach ( Resource *resource, resources )
     {
-        // Set progress value and ensure dialog has time to display when doing extensive updates
-        progress.setValue(progress_value++);
-        QApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
-
         QString name = QString( "%1%2" ).arg( templateBase ).arg( i, templateNumber.length(), 10, QChar( '0' ) ).append( extension );
-        if ( !m_OPFModel.RenameResource( *resource, name ) )
-        {
-            break;
-        }
+        new_filenames[ resource ] = name;
         i++;
     }
 
+    m_OPFModel.RenameResources( new_filenames );
+
     SelectResources(resources);
 }
 
@@ -88,6 +88,13 @@ public:
      */
     QList <Resource *> AllCSSResources();
 
+    /**
+     * All text resources in the Book Browser: the HTML resources
+     * in order, then the CSS resources, then the other text
+     * resources. The OPF and NCX are not included.
+     */
+    QList <Resource *> AllTextResources();
+
     void SelectResources(QList<Resource *> resources);
 
     void RemoveSelection( QList<Resource *> tab_resources );
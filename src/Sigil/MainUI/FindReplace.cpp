@@ -32,6 +32,7 @@
 #include "Misc/SettingsStore.h"
 #include "Misc/SleepFunctions.h"
 #include "Misc/FindReplaceQLineEdit.h"
+#include "PCRE/PCRECache.h"
 
 static const QString SETTINGS_GROUP = "find_replace";
 static const int MAXIMUM_SELECTED_TEXT_LIMIT = 500;
@@ -44,7 +45,8 @@ FindReplace::FindReplace( MainWindow &main_window )
       m_RegexOptionMinimalMatch( false ),
       m_RegexOptionAutoTokenise( false ),
       m_SpellCheck(false),
-      m_LookWhereCurrentFile(false)
+      m_LookWhereCurrentFile(false),
+      m_UseSearchIndex(true)
 {
     ui.setupUi( this );
 
@@ -495,6 +497,7 @@ void FindReplace::SetCodeViewIfNeeded( bool force )
     if ( force ||
             ( !m_LookWhereCurrentFile && 
               ( GetLookWhere() == FindReplace::LookWhere_AllHTMLFiles || 
+                GetLookWhere() == FindReplace::LookWhere_AllFiles ||
                 GetLookWhere() == FindReplace::LookWhere_SelectedHTMLFiles ) &&
               ( m_MainWindow.GetViewState() == MainWindow::ViewState_BookView ||
                 m_MainWindow.GetViewState() == MainWindow::ViewState_PreviewView ) ) )
@@ -548,39 +551,40 @@ QString FindReplace::GetSearchRegex()
     return search;
 }
 
-bool FindReplace::IsCurrentFileInHTMLSelection()
+bool FindReplace::IsCurrentFileInSelection()
 {
     bool found = false;
 
-    QList <Resource *> resources = GetHTMLFiles();
+    QList <Resource *> resources = GetFilesToSearch();
     Resource *current_resource = GetCurrentResource();
-    HTMLResource *current_html_resource = qobject_cast< HTMLResource *>( current_resource );
 
-    if ( current_html_resource )
+    foreach ( Resource *resource, resources )
     {
-        foreach ( Resource *resource, resources )
+        if ( resource->Filename() == current_resource->Filename() )
         {
-            if ( resource->Filename() == current_html_resource->Filename() )
-            {
-                found = true;
-                break;
-            }
+            found = true;
+            break;
         }
     }
     return found;
 }
 
-// Returns all html resources or only those selected in Book Browser
-QList <Resource *> FindReplace::GetHTMLFiles()
+// Returns all html resources, all text resources
+// or only those selected in Book Browser
+QList <Resource *> FindReplace::GetFilesToSearch()
 {
     // For now, this must hold
-    Q_ASSERT( GetLookWhere() == FindReplace::LookWhere_AllHTMLFiles || GetLookWhere() == FindReplace::LookWhere_SelectedHTMLFiles || m_SpellCheck );
+    Q_ASSERT( GetLookWhere() == FindReplace::LookWhere_AllHTMLFiles || GetLookWhere() == FindReplace::LookWhere_AllFiles || GetLookWhere() == FindReplace::LookWhere_SelectedHTMLFiles || m_SpellCheck );
     QList <Resource *> resources;
 
     if ( GetLookWhere() == FindReplace::LookWhere_AllHTMLFiles || m_SpellCheck )
     {
         resources = m_MainWindow.GetAllHTMLResources();
     }
+    else if ( GetLookWhere() == FindReplace::LookWhere_AllFiles )
+    {
+        resources = m_MainWindow.GetAllTextResources();
+    }
     else
     {
         resources = m_MainWindow.GetValidSelectedHTMLResources();
@@ -592,13 +596,13 @@ QList <Resource *> FindReplace::GetHTMLFiles()
 int FindReplace::CountInFiles()
 {
     // For now, this must hold
-    Q_ASSERT( GetLookWhere() == FindReplace::LookWhere_AllHTMLFiles || GetLookWhere() == FindReplace::LookWhere_SelectedHTMLFiles );
+    Q_ASSERT( GetLookWhere() == FindReplace::LookWhere_AllHTMLFiles || GetLookWhere() == FindReplace::LookWhere_AllFiles || GetLookWhere() == FindReplace::LookWhere_SelectedHTMLFiles );
 
     m_MainWindow.GetCurrentContentTab().SaveTabContent();
 
     return SearchOperations::CountInFiles(
             GetSearchRegex(),
-            GetHTMLFiles(),
+            GetFilesToSearch(),
             SearchOperations::CodeViewSearch );
 }
 
@@ -606,14 +610,14 @@ int FindReplace::CountInFiles()
 int FindReplace::ReplaceInAllFiles()
 {
     // For now, this must hold
-    Q_ASSERT( GetLookWhere() == FindReplace::LookWhere_AllHTMLFiles || GetLookWhere() == FindReplace::LookWhere_SelectedHTMLFiles );
+    Q_ASSERT( GetLookWhere() == FindReplace::LookWhere_AllHTMLFiles || GetLookWhere() == FindReplace::LookWhere_AllFiles || GetLookWhere() == FindReplace::LookWhere_SelectedHTMLFiles );
 
     m_MainWindow.GetCurrentContentTab().SaveTabContent();
 
     int count = SearchOperations::ReplaceInAllFIles(
             GetSearchRegex(),
             ui.cbReplace->lineEdit()->text(),
-            GetHTMLFiles(),
+            GetFilesToSearch(),
             SearchOperations::CodeViewSearch );
 
     return count;
@@ -625,7 +629,7 @@ bool FindReplace::FindInAllFiles( Searchable::Direction direction )
     Searchable *searchable = 0;
 
     bool found = false;
-    if ( IsCurrentFileInHTMLSelection() )
+    if ( IsCurrentFileInSelection() )
     {
         searchable = GetAvailableSearchable();
         if ( searchable )
@@ -636,8 +640,7 @@ bool FindReplace::FindInAllFiles( Searchable::Direction direction )
 
     if ( !found )
     {
-        // TODO: make this handle all types of files
-        Resource *containing_resource = GetNextContainingHTMLResource( direction );
+        Resource *containing_resource = GetNextContainingResource( direction );
 
         if ( containing_resource )
         {
@@ -645,7 +648,7 @@ bool FindReplace::FindInAllFiles( Searchable::Direction direction )
             bool has_focus = HasFocus();
 
             // Save selected resources since opening tabs changes selection
-            QList<Resource *>selected_resources = GetHTMLFiles();
+            QList<Resource *>selected_resources = GetFilesToSearch();
 
             m_MainWindow.OpenResource( *containing_resource);
 
@@ -686,94 +689,86 @@ bool FindReplace::FindInAllFiles( Searchable::Direction direction )
     return found;
 }
 
-HTMLResource* FindReplace::GetNextContainingHTMLResource( Searchable::Direction direction )
+TextResource* FindReplace::GetNextContainingResource( Searchable::Direction direction )
 {
-    Resource* current_resource = GetCurrentResource();
-    HTMLResource *starting_html_resource = qobject_cast< HTMLResource *> ( current_resource );
+    // Fetch the files once; getting them sorts them by reading order.
+    QList< Resource* > resources = GetFilesToSearch();
+    int count = resources.count();
 
-    if ( !starting_html_resource || ( GetLookWhere() == FindReplace::LookWhere_SelectedHTMLFiles && !IsCurrentFileInHTMLSelection() ) )
+    if ( count == 0 )
     {
-        QList<Resource *> resources = GetHTMLFiles();
-        if ( resources.isEmpty() )
-        {
-            return NULL;
-        }
-        if ( direction == Searchable::Direction_Up )
-        {
-            starting_html_resource = qobject_cast< HTMLResource *>( resources.first() );
-        }
-        else
-        {
-            starting_html_resource = qobject_cast< HTMLResource *>( resources.last() );
-        }
+        return NULL;
+    }
+
+    int start_index = resources.indexOf( GetCurrentResource() );
+
+    // Start from an end if the current file isn't one being searched
+    if ( start_index == -1 )
+    {
+        start_index = direction == Searchable::Direction_Up ? 0 : count - 1;
     }
 
-    HTMLResource *next_html_resource = starting_html_resource;
+    int step = direction == Searchable::Direction_Up ? -1 : 1;
 
-    bool passed_starting_html_resource = false;
+    // Walk the files in order, wrapping around, and end with the starting one
+    TextResource *containing_resource = NULL;
 
-    while ( !passed_starting_html_resource || ( next_html_resource != starting_html_resource ) )
+    for ( int i = 1; i <= count && !containing_resource; ++i )
     {
-        next_html_resource = GetNextHTMLResource( next_html_resource, direction );
-        if ( next_html_resource == starting_html_resource )
-        {
-             passed_starting_html_resource = true ;
-        }
+        TextResource *text_resource = qobject_cast< TextResource *>( resources.at( ( start_index + step * i + count ) % count ) );
 
-        if ( next_html_resource )
+        if ( text_resource && ResourceContainsCurrentRegex( text_resource ) )
         {
-            if ( ResourceContainsCurrentRegex( next_html_resource ) )
-            {
-                return next_html_resource;
-            }
-            // else continue
+            containing_resource = text_resource;
         }
-        else
-            return NULL;
     }
-    return NULL;
+
+    UpdateSearchIndexToolTip();
+
+    return containing_resource;
 }
 
 
-HTMLResource* FindReplace::GetNextHTMLResource( HTMLResource *current_resource, Searchable::Direction direction )
+bool FindReplace::TextResourceContainsRegex( TextResource &resource, const QString &search_regex )
 {
-    QList <Resource *> resources = GetHTMLFiles();
+    SPCRE *spcre = PCRECache::instance()->getObject( search_regex );
 
-    int max_reading_order       = resources.count() - 1;
-    int current_reading_order   = 0;
-    int next_reading_order      = 0;
+    if ( m_UseSearchIndex && !m_SearchIndex.CanMatch( resource, *spcre ) )
+    {
+        return false;
+    }
 
-    // Find the current resource in the selected/all html entries
-    int i = 0;
-    foreach ( Resource *resource, resources )
+    QReadLocker locker( &resource.GetLock() );
+
+    QString text = resource.GetText();
+
+    // Index files the first time they are searched, and
+    // again the first time they are searched after a change
+    if ( m_UseSearchIndex && !m_SearchIndex.IsCurrent( resource ) )
     {
-        if ( resource->Filename() == current_resource->Filename() )
+        m_SearchIndex.Update( resource, text );
+
+        if ( !m_SearchIndex.CanMatch( resource, *spcre ) )
         {
-            current_reading_order = i;
-            break;
+            return false;
         }
-        i++;
     }
 
-    // We wrap back (if needed)
-    if ( direction == Searchable::Direction_Up )
-    {
-        next_reading_order = current_reading_order - 1 >= 0 ? current_reading_order - 1 : max_reading_order ;
-    }
-    else
-    {
-        next_reading_order = current_reading_order + 1 <= max_reading_order ? current_reading_order + 1 : 0;
-    }
+    return spcre->getFirstMatchInfo( text ).offset.first != -1;
+}
 
-    if ( next_reading_order > max_reading_order || next_reading_order < 0 )
-    {
-        return NULL;
-    }
-    else
+
+void FindReplace::UpdateSearchIndexToolTip()
+{
+    if ( !m_UseSearchIndex )
     {
-        HTMLResource &html_resource = *qobject_cast< HTMLResource *>( resources[ next_reading_order ] );
-        return &html_resource;
+        ui.message->setToolTip( QString() );
+        return;
     }
+
+    ui.message->setToolTip( tr( "Search index: %1 files, %2 KB" )
+                            .arg( m_SearchIndex.Count() )
+                            .arg( ( m_SearchIndex.MemoryUsage() + 1023 ) / 1024 ) );
 }
 
 
@@ -885,6 +880,9 @@ FindReplace::LookWhere FindReplace::GetLookWhere()
     case FindReplace::LookWhere_AllHTMLFiles:
         return static_cast<FindReplace::LookWhere>( look );
         break;
+    case FindReplace::LookWhere_AllFiles:
+        return static_cast<FindReplace::LookWhere>( look );
+        break;
     case FindReplace::LookWhere_SelectedHTMLFiles:
         return static_cast<FindReplace::LookWhere>( look );
         break;
@@ -933,6 +931,8 @@ void FindReplace::ReadSettings()
     SetLookWhere( settings.value( "look_where", 0 ).toInt() );
     SetSearchDirection( settings.value( "search_direction", 0 ).toInt() );
 
+    m_UseSearchIndex = settings.value( "search_index", true ).toBool();
+
     settings.endGroup();
 }
 
@@ -976,6 +976,7 @@ void FindReplace::WriteSettings()
     settings.setValue( "search_mode", GetSearchMode() );
     settings.setValue( "look_where", GetLookWhere() );
     settings.setValue( "search_direction", GetSearchDirection() );
+    settings.setValue( "search_index", m_UseSearchIndex );
     settings.endGroup();
 }
 
@@ -1020,6 +1021,9 @@ void FindReplace::ExtendUI()
     ui.cbLookWhere->addItem(tr("All HTML Files"), FindReplace::LookWhere_AllHTMLFiles);
     look_tooltip += "<dt><b>All HTML Files</b><dd>" + tr("Find or replace in all HTML files in Code View.") + "</dd>";
 
+    ui.cbLookWhere->addItem(tr("All Files"), FindReplace::LookWhere_AllFiles);
+    look_tooltip += "<dt><b>All Files</b><dd>" + tr("Find or replace in all HTML, CSS and other text files in Code View.") + "</dd>";
+
     ui.cbLookWhere->addItem(tr("Selected Files"), FindReplace::LookWhere_SelectedHTMLFiles);
     look_tooltip += "<dt><b>Selected Files</b><dd>" + tr("Restrict the find or replace to the HTML files selected in the Book Browser in Code View.") + "</dd>";
     look_tooltip += "</dl>";
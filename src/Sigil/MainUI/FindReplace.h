@@ -30,8 +30,10 @@
 #include "ui_FindReplace.h"
 #include "BookManipulation/FolderKeeper.h"
 #include "MainUI/MainWindow.h"
+#include "Misc/SearchIndex.h"
 #include "Misc/SearchOperations.h"
 #include "MiscEditors/SearchEditorModel.h"
+#include "ResourceObjects/TextResource.h"
 #include "ViewEditors/Searchable.h"
 
 class HTMLResource;
@@ -53,6 +55,7 @@ public:
     {
         LookWhere_CurrentFile = 0,
         LookWhere_AllHTMLFiles = 10,
+        LookWhere_AllFiles = 15,
         LookWhere_SelectedHTMLFiles = 20
     };  
     
@@ -175,9 +178,9 @@ private:
     // options and fields and then returns it.
     QString GetSearchRegex();
 
-    QList <Resource *> GetHTMLFiles();
+    QList <Resource *> GetFilesToSearch();
 
-    bool IsCurrentFileInHTMLSelection();
+    bool IsCurrentFileInSelection();
 
     void SetLookWhereFromModifier();
 
@@ -189,9 +192,7 @@ private:
 
     bool FindInAllFiles( Searchable::Direction direction );
 
-    HTMLResource* GetNextContainingHTMLResource( Searchable::Direction direction );
-
-    HTMLResource* GetNextHTMLResource( HTMLResource *current_resource, Searchable::Direction direction );
+    TextResource* GetNextContainingResource( Searchable::Direction direction );
 
     Resource* GetCurrentResource();
 
@@ -202,6 +203,23 @@ private:
     template< class T >
     bool ResourceContainsCurrentRegex( T *resource );
 
+    /**
+     * Checks if the search regex matches anywhere in the text
+     * of the resource. The search index is used, and kept up
+     * to date, on the way.
+     *
+     * @param resource The resource to search.
+     * @param search_regex The regex to search for.
+     * @return \c true if there is a match.
+     */
+    bool TextResourceContainsRegex( TextResource &resource, const QString &search_regex );
+
+    /**
+     * Shows how much memory the search index
+     * uses in the tooltip of the message label.
+     */
+    void UpdateSearchIndexToolTip();
+
     /**
      * Returns a list of all the strings
      * currently stored in the find combo box.
@@ -278,6 +296,12 @@ private:
     bool m_SpellCheck;
 
     bool m_LookWhereCurrentFile;
+
+    // Lets Find skip the files a search can't match.
+    // It can be turned off with the "search_index" setting.
+    SearchIndex m_SearchIndex;
+
+    bool m_UseSearchIndex;
 };
 
 
@@ -285,15 +309,22 @@ template< class T >
 bool FindReplace::ResourceContainsCurrentRegex( T *resource )
 {
     // For now, this must hold
-    Q_ASSERT( GetLookWhere() == FindReplace::LookWhere_AllHTMLFiles || GetLookWhere() == FindReplace::LookWhere_SelectedHTMLFiles );
+    Q_ASSERT( GetLookWhere() == FindReplace::LookWhere_AllHTMLFiles || GetLookWhere() == FindReplace::LookWhere_AllFiles || GetLookWhere() == FindReplace::LookWhere_SelectedHTMLFiles );
 
     Resource *generic_resource = resource;
 
-    return SearchOperations::CountInFiles(
-            GetSearchRegex(),
-            QList< Resource* >() << generic_resource,
-            SearchOperations::CodeViewSearch,
-            m_SpellCheck ) > 0;
+    TextResource *text_resource = qobject_cast< TextResource *>( generic_resource );
+
+    if ( m_SpellCheck || !text_resource )
+    {
+        return SearchOperations::CountInFiles(
+                GetSearchRegex(),
+                QList< Resource* >() << generic_resource,
+                SearchOperations::CodeViewSearch,
+                m_SpellCheck ) > 0;
+    }
+
+    return TextResourceContainsRegex( *text_resource, GetSearchRegex() );
 }
 
 #endif // FINDREPLACE_H
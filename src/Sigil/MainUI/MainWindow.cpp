@@ -181,6 +181,12 @@ QList <Resource *> MainWindow::GetAllHTMLResources()
 }
 
 
+QList <Resource *> MainWindow::GetAllTextResources()
+{
+    return m_BookBrowser->AllTextResources();
+}
+
+
 QSharedPointer< Book > MainWindow::GetCurrentBook()
 {
     return m_Book;
@@ -2130,14 +2136,15 @@ void MainWindow::SplitOnSGFChapterMarkers()
     
     QApplication::setOverrideCursor(Qt::WaitCursor);
 
-    QList<Resource *> *changed_resources = new QList<Resource *>();
+    QList<HTMLResource *> split_candidates;
     foreach (Resource *resource, html_resources) { 
-        HTMLResource *html_resource = qobject_cast<HTMLResource *>(resource);
-        QStringList new_chapters = html_resource->SplitOnSGFChapterMarkers();
-        if ( !new_chapters.isEmpty() ) {
-            m_Book->CreateNewChapters( new_chapters, *html_resource );
-            changed_resources->append(resource);
-        }
+        split_candidates.append(qobject_cast<HTMLResource *>(resource));
+    }
+
+    // All the files are split together so the book is only updated once
+    QList<Resource *> *changed_resources = new QList<Resource *>();
+    foreach (HTMLResource *html_resource, m_Book->SplitOnSGFChapterMarkers(split_candidates)) {
+        changed_resources->append(html_resource);
     }
 
     if ( changed_resources->count() > 0 ) {
@@ -2451,7 +2458,8 @@ bool MainWindow::SaveFile( const QString &fullfilepath, bool update_current_file
             m_Book->SetModified( false );
             UpdateUiWithCurrentFile( fullfilepath );
         }
-        statusBar()->showMessage( tr( "File saved" ), STATUSBAR_MSG_DISPLAY_TIME );
+        statusBar()->showMessage( tr( "File saved (%n file(s) written)", "", m_Book->GetLastSaveWriteCount() ),
+                                  STATUSBAR_MSG_DISPLAY_TIME );
     }
     catch ( const ExceptionBase &exception )
     {
@@ -118,6 +118,13 @@ public:
      */
     QList <Resource *> GetAllHTMLResources();
 
+    /**
+     * Returns a list of all text resources, HTML resources first
+     *
+     * @return List of all text resources in book browser order
+     */
+    QList <Resource *> GetAllTextResources();
+
 
     /**
      * Select resources in the Book Browser
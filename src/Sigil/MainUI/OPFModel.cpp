@@ -21,6 +21,7 @@
 
 #include <limits>
 
+#include <QtCore/QSet>
 #include <QtGui/QApplication>
 #include <QtGui/QFileIconProvider>
 
@@ -35,7 +36,6 @@
 #include "ResourceObjects/NCXResource.h"
 #include "sigil_constants.h"
 #include "sigil_exception.h"
-#include "SourceUpdates/UniversalUpdates.h"
 
 static const QList< QChar > FORBIDDEN_FILENAME_CHARS = QList< QChar >() << '<' << '>' << ':' 
                                                                         << '"' << '/' << '\\'
@@ -97,10 +97,13 @@ void OPFModel::Refresh()
 {
     m_RefreshInProgress = true;
 
-    InitializeModel();
-
-    SortFilesByFilenames();
-    SortHTMLFilesByReadingOrder();
+    // Sorting moves rows around, so we only
+    // do it when the update actually changed something
+    if ( UpdateModel() )
+    {
+        SortFilesByFilenames();
+        SortHTMLFilesByReadingOrder();
+    }
 
     m_RefreshInProgress = false;
 }
@@ -310,6 +313,15 @@ void OPFModel::ItemChangedHandler(QStandardItem *item)
 {
     Q_ASSERT(item);
 
+    // Items changed by a refresh or a sort are already in sync with
+    // the book. ResourceRenamed is not emitted for them either; it only
+    // reselects the item of a resource the user renamed, and those
+    // renames come in through here with no refresh in progress.
+    if ( m_RefreshInProgress )
+    {
+        return;
+    }
+
     const QString &identifier = item->data().toString(); 
 
     if (!identifier.isEmpty()) {
@@ -328,31 +340,78 @@ void OPFModel::ItemChangedHandler(QStandardItem *item)
 
 bool OPFModel:: RenameResource( Resource &resource, const QString &new_filename )
 {
-    const QString &old_fullpath = resource.GetFullPath();
+    QHash< Resource*, QString > new_filenames;
+    new_filenames[ &resource ] = new_filename;
 
-    QString old_filename = resource.Filename();
-    QString extension = old_filename.right( old_filename.length() - old_filename.lastIndexOf( '.' ) );
+    return RenameResources( new_filenames );
+}
 
-    QString new_filename_with_extension = new_filename;
 
-    if ( !new_filename.contains( '.')  )
+bool OPFModel::RenameResources( const QHash< Resource*, QString > &new_filenames )
+{
+    QHash< Resource*, QString > renames;
+    QSet< QString > taken_filenames;
+
+    // The filenames the files in the batch give up
+    // are free for the other files in the batch
+    QSet< QString > released_filenames;
+
+    foreach( Resource *resource, new_filenames.keys() )
     {
-        new_filename_with_extension.append( extension );
+        QString old_filename = resource->Filename();
+        QString extension = old_filename.right( old_filename.length() - old_filename.lastIndexOf( '.' ) );
+
+        QString new_filename_with_extension = new_filenames.value( resource );
+
+        if ( !new_filename_with_extension.contains( '.' ) )
+        {
+            new_filename_with_extension.append( extension );
+        }
+
+        if ( old_filename == new_filename_with_extension )
+        {
+            continue;
+        }
+
+        renames[ resource ] = new_filename_with_extension;
+        released_filenames.insert( old_filename );
     }
 
-    if ( old_filename == new_filename_with_extension )
+    foreach( Resource *resource, renames.keys() )
     {
-        return true;
+        const QString &old_filename = resource->Filename();
+        const QString &new_filename_with_extension = renames.value( resource );
+
+        if ( !FilenameIsValid( old_filename, new_filename_with_extension, released_filenames ) )
+        {
+            Refresh();
+
+            return false;
+        }
+
+        if ( taken_filenames.contains( new_filename_with_extension ) )
+        {
+            Utility::DisplayStdErrorDialog( 
+                tr( "The filename \"%1\" is already in use.\n" )
+                .arg( new_filename_with_extension )
+                );
+
+            Refresh();
+
+            return false;
+        }
+
+        taken_filenames.insert( new_filename_with_extension );
     }
 
-    if ( !FilenameIsValid( old_filename, new_filename_with_extension )   )
+    if ( renames.isEmpty() )
     {
-        Refresh();
-
-        return false;
+        return true;
     }
 
-    bool rename_success = resource.RenameTo( new_filename_with_extension );
+    QApplication::setOverrideCursor( Qt::WaitCursor );
+    bool rename_success = m_Book->RenameResources( renames );
+    QApplication::restoreOverrideCursor();
 
     if ( !rename_success )
     {
@@ -365,13 +424,6 @@ bool OPFModel:: RenameResource( Resource &resource, const QString &new_filename
         return false;
     }
 
-    QHash< QString, QString > update;
-    update[ old_fullpath ] = "../" + resource.GetRelativePathToOEBPS();
-
-    QApplication::setOverrideCursor( Qt::WaitCursor );
-    UniversalUpdates::PerformUniversalUpdates( true, m_Book->GetFolderKeeper().GetResourceList(), update );
-    QApplication::restoreOverrideCursor();
-
     emit BookContentModified();
 
     Refresh();
@@ -380,143 +432,182 @@ bool OPFModel:: RenameResource( Resource &resource, const QString &new_filename
 }
 
 
-void OPFModel::InitializeModel()
+bool OPFModel::UpdateModel()
 {
     Q_ASSERT( m_Book );
 
-    ClearModel();
-
     QList< Resource* > resources = m_Book->GetFolderKeeper().GetResourceList();
 
+    QHash< QString, Resource* > resources_by_identifier;
+    QList< HTMLResource* > html_resources;
+
     foreach( Resource *resource, resources )
     {
-        AlphanumericItem *item = new AlphanumericItem ( resource->Icon(), resource->Filename() );
-        item->setDropEnabled( false );
-        item->setData( resource->GetIdentifier() );
-        
+        resources_by_identifier[ resource->GetIdentifier() ] = resource;
+
         if ( resource->Type() == Resource::HTMLResourceType )
+
+            html_resources.append( qobject_cast< HTMLResource* >( resource ) );
+    }
+
+    QHash< HTMLResource*, int > reading_orders = m_Book->GetOPF().GetReadingOrders( html_resources );
+
+    bool changed = false;
+
+    // We remove the items of resources that are no longer in
+    // the book and remember the rest so we can update them in place
+    QHash< QString, QStandardItem* > items_by_identifier;
+
+    QList< QStandardItem* > parents;
+    parents.append( invisibleRootItem()  );
+    parents.append( &m_TextFolderItem    );
+    parents.append( &m_StylesFolderItem  );
+    parents.append( &m_ImagesFolderItem  );
+    parents.append( &m_FontsFolderItem   );
+    parents.append( &m_MiscFolderItem    );
+
+    foreach( QStandardItem *parent, parents )
+    {
+        for ( int i = parent->rowCount() - 1; i >= 0; --i )
         {
-            int reading_order = 
-                m_Book->GetOPF().GetReadingOrder( *qobject_cast< HTMLResource* >( resource ) );
+            QStandardItem *item = parent->child( i );
+            const QString &identifier = item->data().toString();
 
-            if ( reading_order == -1 )
+            // The folder items have no identifier
+            if ( identifier.isEmpty() )
             
-                reading_order = NO_READING_ORDER;
+                continue;
 
-            item->setData( reading_order, READING_ORDER_ROLE );
+            if ( resources_by_identifier.contains( identifier ) )
 
-            // Remove the extension for alphanumeric sorting
-            QString name = resource->Filename().left( resource->Filename().lastIndexOf( '.' ) );
-            item->setData( name, ALPHANUMERIC_ORDER_ROLE );
+                items_by_identifier[ identifier ] = item;
 
-            m_TextFolderItem.appendRow( item );
-        }
+            else
 
-        else if ( resource->Type() == Resource::CSSResourceType )
-        {
-            item->setDragEnabled(false);
-            m_StylesFolderItem.appendRow( item );
+                parent->removeRow( i );
         }
+    }
 
-        else if ( resource->Type() == Resource::ImageResourceType ||
-                  resource->Type() == Resource::SVGResourceType 
-                )
-        {
-            m_ImagesFolderItem.appendRow( item );
-        }
+    foreach( Resource *resource, resources )
+    {
+        QStandardItem *item = items_by_identifier.value( resource->GetIdentifier() );
 
-        else if ( resource->Type() == Resource::FontResourceType )
+        if ( !item )
         {
-            item->setDragEnabled(false);
-            m_FontsFolderItem.appendRow( item );
+            item = CreateItem( *resource );
+            changed = true;
         }
 
-        else if ( resource->Type() == Resource::OPFResourceType || 
-                  resource->Type() == Resource::NCXResourceType )
+        // An inline rename changes the item text before the
+        // resource is renamed, so the text alone can't tell us if
+        // the item was renamed since the last sync. The text is
+        // checked too so a rejected rename is reverted.
+        else if ( item->data( SYNCED_FILENAME_ROLE ) != resource->Filename() ||
+                  item->text() != resource->Filename() )
         {
-            item->setEditable( false );
-            item->setDragEnabled(false);
-            appendRow( item );
+            item->setText( resource->Filename() );
+            item->setData( resource->Filename(), SYNCED_FILENAME_ROLE );
+            changed = true;
         }
 
-        else
+        if ( resource->Type() == Resource::HTMLResourceType )
         {
-            m_MiscFolderItem.appendRow( item );        
-        }
-    }           
-}
-
-
-void OPFModel::UpdateHTMLReadingOrders()
-{
-    QList< HTMLResource* > reading_order_htmls;
+            int reading_order = reading_orders.value( qobject_cast< HTMLResource* >( resource ), -1 );
 
-    for ( int i = 0; i < m_TextFolderItem.rowCount(); ++i )
-    {
-        QStandardItem *html_item = m_TextFolderItem.child( i );
+            if ( reading_order == -1 )
+            
+                reading_order = NO_READING_ORDER;
 
-        Q_ASSERT( html_item );
+            if ( item->data( READING_ORDER_ROLE ) != reading_order )
+            {
+                item->setData( reading_order, READING_ORDER_ROLE );
+                changed = true;
+            }
 
-        html_item->setData( i, READING_ORDER_ROLE );
-        HTMLResource *html_resource =  qobject_cast< HTMLResource* >(
-            &m_Book->GetFolderKeeper().GetResourceByIdentifier( html_item->data().toString() ) );
+            // Remove the extension for alphanumeric sorting
+            QString name = resource->Filename().left( resource->Filename().lastIndexOf( '.' ) );
 
-        if ( html_resource != NULL )
-                
-            reading_order_htmls.append( html_resource );        
+            if ( item->data( ALPHANUMERIC_ORDER_ROLE ) != name )
+            {
+                item->setData( name, ALPHANUMERIC_ORDER_ROLE );
+                changed = true;
+            }
+        }
     }
 
-    m_Book->GetOPF().UpdateSpineOrder( reading_order_htmls );
-    m_Book->SetModified();
+    return changed;
 }
 
 
-void OPFModel::ClearModel()
+QStandardItem* OPFModel::CreateItem( const Resource &resource )
 {
-    while ( m_TextFolderItem.rowCount() != 0 )
+    AlphanumericItem *item = new AlphanumericItem ( resource.Icon(), resource.Filename() );
+    item->setDropEnabled( false );
+    item->setData( resource.GetIdentifier() );
+    item->setData( resource.Filename(), SYNCED_FILENAME_ROLE );
+    
+    if ( resource.Type() == Resource::HTMLResourceType )
     {
-        m_TextFolderItem.removeRow( 0 );
+        m_TextFolderItem.appendRow( item );
     }
 
-    while ( m_StylesFolderItem.rowCount() != 0 )
+    else if ( resource.Type() == Resource::CSSResourceType )
     {
-        m_StylesFolderItem.removeRow( 0 );
+        item->setDragEnabled(false);
+        m_StylesFolderItem.appendRow( item );
     }
 
-    while ( m_ImagesFolderItem.rowCount() != 0 )
+    else if ( resource.Type() == Resource::ImageResourceType ||
+              resource.Type() == Resource::SVGResourceType 
+            )
     {
-        m_ImagesFolderItem.removeRow( 0 );
+        m_ImagesFolderItem.appendRow( item );
     }
 
-    while ( m_FontsFolderItem.rowCount() != 0 )
+    else if ( resource.Type() == Resource::FontResourceType )
     {
-        m_FontsFolderItem.removeRow( 0 );
+        item->setDragEnabled(false);
+        m_FontsFolderItem.appendRow( item );
     }
 
-    while ( m_MiscFolderItem.rowCount() != 0 )
+    else if ( resource.Type() == Resource::OPFResourceType || 
+              resource.Type() == Resource::NCXResourceType )
     {
-        m_MiscFolderItem.removeRow( 0 );
+        item->setEditable( false );
+        item->setDragEnabled(false);
+        appendRow( item );
     }
 
-    int i = 0; 
-    while ( i < invisibleRootItem()->rowCount() )
+    else
     {
-        QStandardItem *child = invisibleRootItem()->child( i, 0 );
+        m_MiscFolderItem.appendRow( item );        
+    }
 
-        if ( child != &m_TextFolderItem   &&
-             child != &m_StylesFolderItem &&
-             child != &m_ImagesFolderItem &&
-             child != &m_FontsFolderItem  &&
-             child != &m_MiscFolderItem )
-        {
-            invisibleRootItem()->removeRow( i );
-        }
+    return item;
+}
 
-        else
-        {
-            ++i;
-        }
+
+void OPFModel::UpdateHTMLReadingOrders()
+{
+    QList< HTMLResource* > reading_order_htmls;
+
+    for ( int i = 0; i < m_TextFolderItem.rowCount(); ++i )
+    {
+        QStandardItem *html_item = m_TextFolderItem.child( i );
+
+        Q_ASSERT( html_item );
+
+        html_item->setData( i, READING_ORDER_ROLE );
+        HTMLResource *html_resource =  qobject_cast< HTMLResource* >(
+            &m_Book->GetFolderKeeper().GetResourceByIdentifier( html_item->data().toString() ) );
+
+        if ( html_resource != NULL )
+                
+            reading_order_htmls.append( html_resource );        
     }
+
+    m_Book->GetOPF().UpdateSpineOrder( reading_order_htmls );
+    m_Book->SetModified();
 }
 
 
@@ -594,7 +685,9 @@ void OPFModel::SortHTMLFilesByAlphanumeric( QList <QModelIndex> index_list )
 }
 
 
-bool OPFModel::FilenameIsValid( const QString &old_filename, const QString &new_filename )
+bool OPFModel::FilenameIsValid( const QString &old_filename,
+                                const QString &new_filename,
+                                const QSet< QString > &released_filenames )
 {
     foreach( QChar character, new_filename )
     {
@@ -622,7 +715,8 @@ bool OPFModel::FilenameIsValid( const QString &old_filename, const QString &new_
         return false;
     }
 
-    if ( new_filename != m_Book->GetFolderKeeper().GetUniqueFilenameVersion( new_filename ) )
+    if ( !released_filenames.contains( new_filename ) &&
+         new_filename != m_Book->GetFolderKeeper().GetUniqueFilenameVersion( new_filename ) )
     {
         Utility::DisplayStdErrorDialog( 
             tr( "The filename \"%1\" is already in use.\n" )
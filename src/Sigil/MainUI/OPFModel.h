@@ -23,6 +23,8 @@
 #ifndef OPFMODEL_H
 #define OPFMODEL_H
 
+#include <QtCore/QHash>
+#include <QtCore/QSet>
 #include <QtCore/QSharedPointer>
 #include <QtGui/QStandardItemModel>
 
@@ -67,8 +69,8 @@ public:
     void SetBook( QSharedPointer< Book > book );
 
     /**
-     * Forces the recreation of the model
-     * from the information in the stored book.
+     * Updates the model with the 
+     * information in the stored book.
      */
     void Refresh();
 
@@ -158,6 +160,19 @@ public:
      */
     bool RenameResource( Resource &resource, const QString &new_filename );
 
+    /**
+     * Renames a batch of resources with one update of the book.
+     * Nothing is renamed if any of the new filenames is invalid.
+     * A new filename can be the current filename of another
+     * resource in the batch.
+     *
+     * @param new_filenames The new filenames, keyed by resource.
+     *                      A filename without an extension gets
+     *                      the extension of the old one.
+     * @return Whether the rename succeeded or not
+     */
+    bool RenameResources( const QHash< Resource*, QString > &new_filenames );
+
 signals:
 
     /**
@@ -194,10 +209,25 @@ private slots:
 private:
 
     /**
-     * Initializes an empty model with data. It is filled 
-     * using information from the stored book.
+     * Brings the model in line with the stored book.
+     * Items of removed resources are removed, items for new resources
+     * are added and the rest are updated in place, so a refresh
+     * after a small change to the book only touches a few rows.
+     *
+     * @return \c true if any items were added, renamed or
+     *         given a new reading order or alphanumeric order,
+     *         i.e. if the model needs to be sorted again.
+     */
+    bool UpdateModel();
+
+    /**
+     * Creates an item for the resource and adds it
+     * to the appropriate folder.
+     *
+     * @param resource The resource the item represents.
+     * @return The new item.
      */
-    void InitializeModel();
+    QStandardItem* CreateItem( const Resource &resource );
 
     /**
      * Updates the reading orders of the HTMLResources
@@ -220,11 +250,6 @@ private:
      */
     void SortHTMLFilesByAlphanumeric( QList <QModelIndex> index_list );
 
-    /**
-     * Removes all data from the model.
-     */
-    void ClearModel();
-
     /**
      * Determines if a filename is valid. If it is not,
      * an error dialog is presented to the user informing
@@ -232,9 +257,14 @@ private:
      *
      * @param old_filename The old filename of the file.
      * @param new_filename The requested new filename of the file.
+     * @param released_filenames The filenames of other files that
+     *                           are renamed along with this one.
+     *                           These don't count as in use.
      * @return \c true if the filename is valid.
      */
-    bool FilenameIsValid( const QString &old_filename, const QString &new_filename );
+    bool FilenameIsValid( const QString &old_filename,
+                          const QString &new_filename,
+                          const QSet< QString > &released_filenames = QSet< QString >() );
 
 
     ///////////////////////////////
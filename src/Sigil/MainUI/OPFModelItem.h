@@ -32,6 +32,7 @@
 static const int NO_READING_ORDER        = std::numeric_limits< int >::max();
 static const int READING_ORDER_ROLE      = Qt::UserRole + 2;
 static const int ALPHANUMERIC_ORDER_ROLE = Qt::UserRole + 3;
+static const int SYNCED_FILENAME_ROLE    = Qt::UserRole + 4;
 
 /**
  * A re-implementation of QStandardItem to
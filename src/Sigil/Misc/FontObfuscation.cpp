@@ -57,85 +57,75 @@ QByteArray AdobeKeyFromIdentifier( const QString &identifier )
 }
 
 
-void IdpfObfuscate( const QString &filepath, const QString &identifier )
+// XORs the start of the contents with the key
+void XorWithKey( QByteArray &contents, const QByteArray &key, int num_bytes )
 {
-    QFile file( filepath );
-    if ( !file.open( QFile::ReadWrite ) )
-
-        return;
-
-    QByteArray contents = file.readAll();
+    int key_size = key.size();
 
-    QByteArray key = IdpfKeyFromIdentifier( identifier );
-    int key_size   = key.size();
-
-    for ( int i = 0; ( i < IDPF_METHOD_NUM_BYTES ) && ( i < contents.size() ); ++i )
+    for ( int i = 0; ( i < num_bytes ) && ( i < contents.size() ); ++i )
     {
         contents[ i ] = contents[ i ] ^ key[ i % key_size ]; 
     }
+}
 
-    file.seek( 0 );
-    file.write( contents );
+
+void ThrowObfuscationError( const QString &filepath, const QString &algorithm, const QString &identifier )
+{
+    boost_throw( FontObfuscationError() 
+                 << errinfo_font_filepath( filepath.toStdString() )
+                 << errinfo_font_obfuscation_algorithm( algorithm.toStdString() )
+                 << errinfo_font_obfuscation_key( identifier.toStdString() )
+               );
 }
 
+};
 
-void AdobeObfuscate( const QString &filepath, const QString &identifier )
+
+void FontObfuscation::ObfuscateFile( const QString &filepath, 
+                                     const QString &algorithm, 
+                                     const QString &identifier )
 {
+    if ( !QFileInfo( filepath ).exists() )
+
+        ThrowObfuscationError( filepath, algorithm, identifier );
+
     QFile file( filepath );
     if ( !file.open( QFile::ReadWrite ) )
 
         return;
 
-    QByteArray contents = file.readAll();
-
-    QByteArray key = AdobeKeyFromIdentifier( identifier );
-    int key_size   = key.size();
-
-    for ( int i = 0; ( i < ADOBE_METHOD_NUM_BYTES ) && ( i < contents.size() ); ++i )
-    {
-        contents[ i ] = contents[ i ] ^ key[ i % key_size ]; 
-    }
+    QByteArray contents = ObfuscateData( file.readAll(), algorithm, identifier, filepath );
 
     file.seek( 0 );
     file.write( contents );
 }
 
-};
-
 
-void FontObfuscation::ObfuscateFile( const QString &filepath, 
-                                     const QString &algorithm, 
-                                     const QString &identifier )
+QByteArray FontObfuscation::ObfuscateData( const QByteArray &data,
+                                           const QString &algorithm, 
+                                           const QString &identifier,
+                                           const QString &filepath )
 {
-    if ( !QFileInfo( filepath ).exists() || 
-         algorithm.isEmpty()             ||
-         identifier.isEmpty() )
-    {
-        boost_throw( FontObfuscationError() 
-                     << errinfo_font_filepath( filepath.toStdString() )
-                     << errinfo_font_obfuscation_algorithm( algorithm.toStdString() )
-                     << errinfo_font_obfuscation_key( identifier.toStdString() )
-                   );
-    }
+    if ( algorithm.isEmpty() || identifier.isEmpty() )
+
+        ThrowObfuscationError( filepath, algorithm, identifier );
+
+    QByteArray contents = data;
 
     if ( algorithm == ADOBE_FONT_ALGO_ID )
     {
-        AdobeObfuscate( filepath, identifier );
+        XorWithKey( contents, AdobeKeyFromIdentifier( identifier ), ADOBE_METHOD_NUM_BYTES );
     }
 
     else if ( algorithm == IDPF_FONT_ALGO_ID )
     {
-        IdpfObfuscate( filepath, identifier );
+        XorWithKey( contents, IdpfKeyFromIdentifier( identifier ), IDPF_METHOD_NUM_BYTES );
     }
 
     else
     {
-        boost_throw( FontObfuscationError() 
-                     << errinfo_font_filepath( filepath.toStdString() )
-                     << errinfo_font_obfuscation_algorithm( algorithm.toStdString() )
-                     << errinfo_font_obfuscation_key( identifier.toStdString() )
-                    );
+        ThrowObfuscationError( filepath, algorithm, identifier );
     }
-}
-
 
+    return contents;
+}
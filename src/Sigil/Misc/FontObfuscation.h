@@ -23,13 +23,21 @@
 #ifndef FONTOBFUSCATION_H
 #define FONTOBFUSCATION_H
 
-class QString;
+#include <QtCore/QByteArray>
+#include <QtCore/QString>
 
 namespace FontObfuscation
 {
     void ObfuscateFile( const QString &filepath, 
                         const QString &algorithm, 
                         const QString &identifier );
+
+    // Returns the (de)obfuscated font data; the file path
+    // is only used for error reporting
+    QByteArray ObfuscateData( const QByteArray &data,
+                              const QString &algorithm, 
+                              const QString &identifier,
+                              const QString &filepath = QString() );
 }
 
 #endif // FONTOBFUSCATION_H
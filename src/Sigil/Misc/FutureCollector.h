@@ -0,0 +1,145 @@
+/************************************************************************
+**
+**  Copyright (C) 2012  Sigil Developers
+**
+**  This file is part of Sigil.
+**
+**  Sigil is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  Sigil is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with Sigil.  If not, see <http://www.gnu.org/licenses/>.
+**
+*************************************************************************/
+
+#pragma once
+#ifndef FUTURECOLLECTOR_H
+#define FUTURECOLLECTOR_H
+
+#include <QtCore/QFuture>
+#include <QtCore/QFutureWatcher>
+#include <QtCore/QList>
+#include <QtCore/QThread>
+#include <QtGui/QApplication>
+#include <QtGui/QProgressDialog>
+
+/**
+ * Collects the results of a QtConcurrent run (mapped or run) as they
+ * become ready, in the order of the inputs. Each result is copied once.
+ *
+ * On the GUI thread the wait sleeps in the event loop until the run
+ * reports progress, so the GUI keeps painting without spinning, and
+ * user input only reaches the (modal) progress dialog.
+ * Elsewhere it simply blocks until the run is finished.
+ *
+ * Since timers and queued slots also run while waiting on the GUI
+ * thread, this is only meant for runs the user watches (and can
+ * cancel) in a progress dialog. Other runs should block with
+ * QtConcurrent::blockingMapped or QFuture::waitForFinished.
+ */
+template< typename T >
+class FutureCollector
+{
+
+public:
+
+    /**
+     * Constructor.
+     *
+     * @param future The run to collect the results of.
+     */
+    FutureCollector( const QFuture< T > &future )
+        :
+        m_Future( future )
+    {
+    }
+
+    /**
+     * Waits for the run to finish and collects its results.
+     *
+     * @param progress The dialog to show the progress in. Its Cancel
+     *                 button cancels the run.
+     * @return \c false if the run was canceled. The results of the
+     *         inputs up to the first one that wasn't processed
+     *         are collected even then.
+     */
+    bool Wait( QProgressDialog *progress )
+    {
+        if ( QThread::currentThread() != QApplication::instance()->thread() )
+        {
+            m_Future.waitForFinished();
+            CollectReadyResults();
+
+            return !m_Future.isCanceled();
+        }
+
+        // The watcher posts an event whenever an input has been
+        // processed, which wakes up the event processing below.
+        QFutureWatcher< T > watcher;
+
+        QObject::connect( &watcher, SIGNAL( progressValueChanged( int ) ), progress, SLOT( setValue( int ) ) );
+        QObject::connect( progress, SIGNAL( canceled() ),                   &watcher, SLOT( cancel() ) );
+
+        watcher.setFuture( m_Future );
+
+        while ( !m_Future.isFinished() )
+        {
+            QEventLoop::ProcessEventsFlags flags = QEventLoop::WaitForMoreEvents;
+
+            if ( !progress->isVisible() )
+
+                flags |= QEventLoop::ExcludeUserInputEvents;
+
+            QApplication::processEvents( flags );
+
+            CollectReadyResults();
+        }
+
+        CollectReadyResults();
+
+        return !m_Future.isCanceled();
+    }
+
+    /**
+     * The results collected so far, in the order of the inputs.
+     *
+     * @return The results.
+     */
+    const QList< T >& Results() const
+    {
+        return m_Results;
+    }
+
+private:
+
+    /**
+     * Takes the results that became ready since the last call.
+     * Only the new ones are copied, so collecting N results
+     * costs N copies in all.
+     */
+    void CollectReadyResults()
+    {
+        while ( m_Future.isResultReadyAt( m_Results.count() ) )
+        {
+            m_Results.append( m_Future.resultAt( m_Results.count() ) );
+        }
+    }
+
+
+    ///////////////////////////////
+    // PRIVATE MEMBER VARIABLES
+    ///////////////////////////////
+
+    QFuture< T > m_Future;
+
+    QList< T > m_Results;
+};
+
+#endif // FUTURECOLLECTOR_H
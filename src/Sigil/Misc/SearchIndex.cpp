@@ -0,0 +1,180 @@
+/************************************************************************
+**
+**  Copyright (C) 2012  Sigil Developers
+**
+**  This file is part of Sigil.
+**
+**  Sigil is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  Sigil is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with Sigil.  If not, see <http://www.gnu.org/licenses/>.
+**
+*************************************************************************/
+
+#include <algorithm>
+
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+
+#include "Misc/SearchIndex.h"
+#include "PCRE/SPCRE.h"
+#include "ResourceObjects/Resource.h"
+
+// The bitmap of a resource gets this many bits for each distinct
+// trigram in its text, which makes about one in eight lookups
+// of a trigram the text doesn't have report it as present.
+static const int BITS_PER_TRIGRAM = 8;
+
+// The smallest and largest bitmap sizes. Both are powers of two.
+static const int MIN_TRIGRAM_BITS = 1024;
+static const int MAX_TRIGRAM_BITS = 1 << 20;
+
+
+// Only ASCII letters are folded. Searches that ignore case only
+// use ASCII literals for lookups (see SPCRE::getRequiredLiterals),
+// and folding never hurts a lookup that doesn't ignore case.
+static inline ushort FoldCase( ushort c )
+{
+    return c >= 'A' && c <= 'Z' ? c + ( 'a' - 'A' ) : c;
+}
+
+
+static inline uint TrigramHash( const ushort *chars )
+{
+    quint64 key = ( (quint64) FoldCase( chars[ 0 ] ) << 32 ) |
+                  ( (quint64) FoldCase( chars[ 1 ] ) << 16 ) |
+                  FoldCase( chars[ 2 ] );
+
+    // The MurmurHash3 finalizer. The bitmaps use the low bits of
+    // the hash, so all of them have to depend on every character.
+    key ^= key >> 33;
+    key *= Q_UINT64_C( 0xff51afd7ed558ccd );
+    key ^= key >> 33;
+    key *= Q_UINT64_C( 0xc4ceb9fe1a85ec53 );
+    key ^= key >> 33;
+
+    return (uint) key;
+}
+
+
+SearchIndex::SearchIndex( QObject *parent )
+    : QObject( parent )
+{
+}
+
+
+bool SearchIndex::IsCurrent( const Resource &resource ) const
+{
+    QHash< QString, Entry >::const_iterator entry = m_Entries.constFind( resource.GetIdentifier() );
+
+    return entry != m_Entries.constEnd() && entry->generation == resource.GetModificationGeneration();
+}
+
+
+void SearchIndex::Update( const Resource &resource, const QString &text )
+{
+    if ( IsCurrent( resource ) )
+
+        return;
+
+    const ushort *chars = text.utf16();
+    int trigram_count = qMax( text.length() - 2, 0 );
+
+    QVector< uint > hashes( trigram_count );
+
+    for ( int i = 0; i < trigram_count; ++i )
+    {
+        hashes[ i ] = TrigramHash( chars + i );
+    }
+
+    // Size the bitmap for the distinct trigrams; text,
+    // and markup especially, repeats a lot of them.
+    qSort( hashes );
+    int distinct_count = std::unique( hashes.begin(), hashes.end() ) - hashes.begin();
+
+    int size = MIN_TRIGRAM_BITS;
+
+    while ( size < distinct_count * BITS_PER_TRIGRAM && size < MAX_TRIGRAM_BITS )
+    {
+        size *= 2;
+    }
+
+    Entry entry;
+    entry.generation = resource.GetModificationGeneration();
+    entry.trigrams   = QBitArray( size );
+
+    for ( int i = 0; i < distinct_count; ++i )
+    {
+        entry.trigrams.setBit( hashes[ i ] & ( size - 1 ) );
+    }
+
+    m_Entries.insert( resource.GetIdentifier(), entry );
+
+    connect( &resource, SIGNAL( Deleted( const Resource& ) ),
+             this,      SLOT( RemoveResource( const Resource& ) ), Qt::UniqueConnection );
+}
+
+
+bool SearchIndex::CanMatch( const Resource &resource, SPCRE &spcre ) const
+{
+    QHash< QString, Entry >::const_iterator entry = m_Entries.constFind( resource.GetIdentifier() );
+
+    if ( entry == m_Entries.constEnd() || entry->generation != resource.GetModificationGeneration() )
+
+        return true;
+
+    const QBitArray &trigrams = entry->trigrams;
+    int mask = trigrams.size() - 1;
+
+    foreach ( const QString &literal, spcre.getRequiredLiterals() )
+    {
+        const ushort *chars = literal.utf16();
+
+        for ( int i = 0; i + 2 < literal.length(); ++i )
+        {
+            if ( !trigrams.testBit( TrigramHash( chars + i ) & mask ) )
+
+                return false;
+        }
+    }
+
+    return true;
+}
+
+
+int SearchIndex::Count() const
+{
+    return m_Entries.count();
+}
+
+
+int SearchIndex::MemoryUsage() const
+{
+    int bytes = 0;
+
+    QHash< QString, Entry >::const_iterator entry = m_Entries.constBegin();
+
+    for ( ; entry != m_Entries.constEnd(); ++entry )
+    {
+        bytes += sizeof( Entry ) + sizeof( QString ) +
+                 entry.key().size() * sizeof( QChar ) +
+                 entry->trigrams.size() / 8;
+    }
+
+    return bytes;
+}
+
+
+void SearchIndex::RemoveResource( const Resource &resource )
+{
+    m_Entries.remove( resource.GetIdentifier() );
+}
+
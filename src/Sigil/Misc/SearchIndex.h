@@ -0,0 +1,127 @@
+/************************************************************************
+**
+**  Copyright (C) 2012  Sigil Developers
+**
+**  This file is part of Sigil.
+**
+**  Sigil is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  Sigil is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with Sigil.  If not, see <http://www.gnu.org/licenses/>.
+**
+*************************************************************************/
+
+#pragma once
+#ifndef SEARCHINDEX_H
+#define SEARCHINDEX_H
+
+#include <QtCore/QBitArray>
+#include <QtCore/QHash>
+#include <QtCore/QObject>
+#include <QtCore/QString>
+
+class Resource;
+class SPCRE;
+
+/**
+ * An in-memory index of the trigrams (runs of three characters)
+ * in the text of resources. It's used to skip the resources a search
+ * can't match without running the search on them.
+ *
+ * The trigrams of each resource are hashed into a bitmap sized for the
+ * number of trigrams in the text. A bitmap can report trigrams the text
+ * doesn't have, but never misses one it has, so the index only rules out
+ * resources that really can't match. An entry is tied to the modification
+ * generation of its resource and is ignored once the resource changes,
+ * until it's built again from the new text.
+ */
+class SearchIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    /**
+     * Constructor.
+     *
+     * @param parent The object's parent.
+     */
+    SearchIndex( QObject *parent = 0 );
+
+    /**
+     * Checks if the index has an entry for the current text of the resource.
+     *
+     * @param resource The resource to check.
+     * @return \c true if the entry is up to date.
+     */
+    bool IsCurrent( const Resource &resource ) const;
+
+    /**
+     * Indexes the text of the resource, unless the entry for it
+     * is already up to date. The caller should hold the resource's
+     * read lock so the text matches the resource's generation.
+     *
+     * @param resource The resource the text belongs to.
+     * @param text The current text of the resource.
+     */
+    void Update( const Resource &resource, const QString &text );
+
+    /**
+     * Checks if the pattern can match the text of the resource.
+     * The check uses the literal text the pattern requires. It's only
+     * made if the entry for the resource is up to date; otherwise
+     * nothing is known and the answer is \c true.
+     *
+     * @param resource The resource to check.
+     * @param spcre The pattern that will be searched for.
+     * @return \c false if the pattern can't match the resource's text.
+     */
+    bool CanMatch( const Resource &resource, SPCRE &spcre ) const;
+
+    /**
+     * The number of resources in the index.
+     *
+     * @return The number of entries.
+     */
+    int Count() const;
+
+    /**
+     * The memory used by the index, in bytes.
+     *
+     * @return The approximate size of the index.
+     */
+    int MemoryUsage() const;
+
+private slots:
+
+    /**
+     * Drops the entry of a resource that was deleted.
+     *
+     * @param resource The deleted resource.
+     */
+    void RemoveResource( const Resource &resource );
+
+private:
+
+    struct Entry
+    {
+        // The modification generation of the indexed text.
+        int generation;
+
+        // The hashes of the trigrams in the text.
+        QBitArray trigrams;
+    };
+
+    // Keyed by resource identifier.
+    QHash< QString, Entry > m_Entries;
+};
+
+#endif // SEARCHINDEX_H
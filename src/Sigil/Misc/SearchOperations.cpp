@@ -29,6 +29,7 @@
 #include "BookManipulation/CleanSource.h"
 #include "BookManipulation/XercesCppUse.h"
 #include "BookManipulation/XhtmlDoc.h"
+#include "Misc/FutureCollector.h"
 #include "Misc/SearchOperations.h"
 #include "Misc/Utility.h"
 #include "PCRE/PCRECache.h"
@@ -39,6 +40,7 @@
 #include "sigil_constants.h"
 
 using boost::make_tuple;
+using boost::shared_ptr;
 using boost::tie;
 using boost::tuple;
 
@@ -47,16 +49,37 @@ int SearchOperations::CountInFiles( const QString &search_regex,
                                     SearchType search_type,
                                     bool check_spelling )
 {
-    QProgressDialog progress( QObject::tr( "Counting occurrences.." ), QString(), 0, resources.count() );
+    QProgressDialog progress( QObject::tr( "Counting occurrences.." ), QObject::tr( "Cancel" ), 0, resources.count() );
     progress.setMinimumDuration( PROGRESS_BAR_MINIMUM_DURATION );
-    int progress_value = 0;
+    progress.setWindowModality( Qt::ApplicationModal );
 
-    // Count sequentially in order to see if occassional crashes are due to threading 
     int count = 0;
-    foreach (Resource *resource, resources) {
-        progress.setValue(progress_value++);
 
-        count += CountInFile(search_regex, resource, search_type, check_spelling);
+    // Hunspell isn't thread safe, so spell checking stays on this thread
+    if ( check_spelling )
+    {
+        for ( int i = 0; i < resources.count() && !progress.wasCanceled(); ++i )
+        {
+            progress.setValue( i );
+
+            count += CountInFile( search_regex, resources.at( i ), search_type, check_spelling );
+        }
+
+        return progress.wasCanceled() ? 0 : count;
+    }
+
+    QFuture< int > future = QtConcurrent::mapped( resources, 
+        boost::bind( CountInFile, search_regex, _1, search_type, check_spelling ) );
+
+    FutureCollector< int > collector( future );
+
+    if ( !collector.Wait( &progress ) )
+
+        return 0;
+
+    foreach( int file_count, collector.Results() )
+    {
+        count += file_count;
     }
 
     return count;
@@ -68,16 +91,60 @@ int SearchOperations::ReplaceInAllFIles( const QString &search_regex,
                                          QList< Resource* > resources, 
                                          SearchType search_type )
 {
-    QProgressDialog progress( QObject::tr( "Replacing search term..." ), QString(), 0, resources.count() );
+    QProgressDialog progress( QObject::tr( "Replacing search term..." ), QObject::tr( "Cancel" ), 0, resources.count() );
     progress.setMinimumDuration( PROGRESS_BAR_MINIMUM_DURATION );
-    int progress_value = 0;
+    progress.setWindowModality( Qt::ApplicationModal );
+
+    // The new texts are created on the thread pool, but they are only
+    // written back to the resources here, in the order of the resources,
+    // once all the files have been processed. So a canceled run
+    // leaves the book untouched.
+    QFuture< tuple< QString, int, QStringList > > future = QtConcurrent::mapped( resources, 
+        boost::bind( ReplaceInFile, search_regex, replacement, _1, search_type ) );
+
+    FutureCollector< tuple< QString, int, QStringList > > collector( future );
+
+    if ( !collector.Wait( &progress ) )
+
+        return 0;
 
-    // Replace sequentially in order to see if occassional crashes are due to threading 
     int count = 0;
-    foreach (Resource *resource, resources) {
-        progress.setValue(progress_value++);
 
-        count += ReplaceInFile(search_regex, replacement, resource, search_type);
+    for ( int i = 0; i < resources.count(); ++i )
+    {
+        QString new_text;
+        int file_count;
+        QStringList linked_resource_paths;
+
+        tie( new_text, file_count, linked_resource_paths ) = collector.Results().at( i );
+
+        // Files without matches are left as they are
+        if ( file_count == 0 )
+
+            continue;
+
+        QWriteLocker locker( &resources.at( i )->GetLock() );
+
+        // TextResource::SetText is not virtual, so HTML files
+        // have to go through their own setter
+        HTMLResource *html_resource = qobject_cast< HTMLResource* >( resources.at( i ) );
+
+        if ( html_resource )
+        {
+            // The new text was already cleaned on the thread pool
+            html_resource->SetUpdatedText( new_text, linked_resource_paths );
+            count += file_count;
+
+            continue;
+        }
+
+        TextResource *text_resource = qobject_cast< TextResource* >( resources.at( i ) );
+
+        if ( text_resource )
+        {
+            text_resource->SetText( new_text );
+            count += file_count;
+        }
     }
 
     return count;
@@ -100,7 +167,8 @@ int SearchOperations::CountInFile( const QString &search_regex,
 
     TextResource *text_resource = qobject_cast< TextResource* >( resource );
     
-    if ( text_resource )
+    // Only HTML files are spell checked
+    if ( text_resource && !check_spelling )
     {
         return CountInTextFile( search_regex, text_resource );
     }
@@ -118,7 +186,10 @@ int SearchOperations::CountInHTMLFile( const QString &search_regex,
 {
     if ( search_type == SearchOperations::CodeViewSearch )
     {
-        const QString &text = CleanSource::PrettyPrint( html_resource->GetText() );
+        // We search the stored text. That's the text Code View shows,
+        // and running every file through Tidy first would cost far
+        // more than the search itself.
+        const QString &text = html_resource->GetText();
 
         if ( check_spelling )
         {
@@ -126,7 +197,7 @@ int SearchOperations::CountInHTMLFile( const QString &search_regex,
         }
         else
         {
-            return PCRECache::instance()->getObject( search_regex )->getEveryMatchInfo( text ).count();
+            return PCRECache::instance()->getObject( search_regex )->countMatches( text );
         }
     }
 
@@ -136,17 +207,18 @@ int SearchOperations::CountInHTMLFile( const QString &search_regex,
 
 int SearchOperations::CountInTextFile( const QString &search_regex, TextResource* text_resource )
 {
-    // TODO
-    return 0;
+    // Stylesheets, XML and plain text files are
+    // searched exactly as they are stored
+    return PCRECache::instance()->getObject( search_regex )->countMatches( text_resource->GetText() );
 }
 
 
-int SearchOperations::ReplaceInFile( const QString &search_regex,
-                                     const QString &replacement, 
-                                     Resource* resource, 
-                                     SearchType search_type )
+tuple< QString, int, QStringList > SearchOperations::ReplaceInFile( const QString &search_regex,
+                                                                    const QString &replacement, 
+                                                                    Resource* resource, 
+                                                                    SearchType search_type )
 {
-    QWriteLocker locker( &resource->GetLock() );
+    QReadLocker locker( &resource->GetLock() );
 
     HTMLResource *html_resource = qobject_cast< HTMLResource* >( resource );
 
@@ -163,40 +235,59 @@ int SearchOperations::ReplaceInFile( const QString &search_regex,
     }
 
     // We should never get here.
-    return 0;
+    return make_tuple( QString(), 0, QStringList() );
 }
 
 
-int SearchOperations::ReplaceHTMLInFile( const QString &search_regex,
-                                         const QString &replacement, 
-                                         HTMLResource* html_resource, 
-                                         SearchType search_type )
+tuple< QString, int, QStringList > SearchOperations::ReplaceHTMLInFile( const QString &search_regex,
+                                                                        const QString &replacement, 
+                                                                        HTMLResource* html_resource, 
+                                                                        SearchType search_type )
 {
     if ( search_type == SearchOperations::CodeViewSearch )
     {
-        const QString &text = CleanSource::PrettyPrint(  html_resource->GetText() );
+        const QString &text = html_resource->GetText();
 
         QString new_text;
         int count;
 
         tie( new_text, count ) = PerformGlobalReplace( text, search_regex, replacement );
 
-        html_resource->SetText(CleanSource::Rinse( new_text ));
+        // Only the files we actually changed need to be normalized
+        if ( count == 0 )
+
+            return make_tuple( QString(), 0, QStringList() );
+
+        // We clean here rather than in HTMLResource::SetText
+        // so Tidy runs on the thread pool and not on the GUI thread
+        new_text = CleanSource::Clean( CleanSource::Rinse( new_text ) );
 
-        return count;
+        shared_ptr< xc::DOMDocument > document = XhtmlDoc::LoadTextIntoDocument( new_text );
+
+        return make_tuple( new_text, count, HTMLResource::GetPathsToLinkedResources( *document.get() ) );
     }
 
     //TODO: BookViewSearch
-    return 0;
+    return make_tuple( QString(), 0, QStringList() );
 }
 
 
-int SearchOperations::ReplaceTextInFile( const QString &search_regex,
-                                         const QString &replacement, 
-                                         TextResource* text_resource )
+tuple< QString, int, QStringList > SearchOperations::ReplaceTextInFile( const QString &search_regex,
+                                                                        const QString &replacement, 
+                                                                        TextResource* text_resource )
 {
-    // TODO
-    return 0;
+    QString new_text;
+    int count;
+
+    tie( new_text, count ) = PerformGlobalReplace( text_resource->GetText(), search_regex, replacement );
+
+    // Unlike HTML, the new text is used as it is: stylesheets need no
+    // normalizing and XML files are not parsed and written out again
+    if ( count == 0 )
+
+        return make_tuple( QString(), 0, QStringList() );
+
+    return make_tuple( new_text, count, QStringList() );
 }
 
 
@@ -204,23 +295,9 @@ tuple< QString, int > SearchOperations::PerformGlobalReplace( const QString &tex
                                                               const QString &search_regex,
                                                               const QString &replacement )
 {
-    QString new_text = text;
-    int count = 0;
+    QString new_text;
 
-    SPCRE *spcre = PCRECache::instance()->getObject( search_regex );
-    QList<SPCRE::MatchInfo> match_info = spcre->getEveryMatchInfo( text );
-
-    for ( int i =  match_info.count() - 1; i >= 0; i-- )
-    {
-        QString match_segement = Utility::Substring( match_info.at( i ).offset.first, match_info.at( i ).offset.second, new_text );
-        QString replacement_text;
-
-        if ( spcre->replaceText( match_segement, match_info.at( i ).capture_groups_offsets, replacement, replacement_text ) )
-        {
-            new_text.replace( match_info.at( i ).offset.first, match_info.at( i ).offset.second - match_info.at( i ).offset.first, replacement_text );
-            count++;
-        }
-    }
+    int count = PCRECache::instance()->getObject( search_regex )->replaceAll( text, replacement, new_text );
 
     return make_tuple( new_text, count );
 }
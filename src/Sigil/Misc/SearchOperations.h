@@ -25,6 +25,8 @@
 
 #include <boost/tuple/tuple.hpp>
 
+#include <QtCore/QStringList>
+
 class Resource;
 class TextResource;
 class HTMLResource;
@@ -76,19 +78,29 @@ private:
     static int CountInTextFile( const QString &search_regex,
                                 TextResource* text_resource );
 
-    static int ReplaceInFile( const QString &search_regex,
-                              const QString &replacement,
-                              Resource* resource,
-                              SearchType search_type );
-
-    static int ReplaceHTMLInFile( const QString &search_regex,
-                                  const QString &replacement,
-                                  HTMLResource* html_resource,
-                                  SearchType search_type );
-
-    static int ReplaceTextInFile( const QString &search_regex,
-                                  const QString &replacement,
-                                  TextResource* text_resource );
+    /**
+     * Performs the replacements on the text of a resource.
+     * The resource itself is not modified.
+     *
+     * @return The new text of the resource, the number of
+     *         replacements and, for HTML files, the paths to the
+     *         linked resources of the new text. The text is empty
+     *         if there were no replacements. New HTML text is
+     *         already cleaned.
+     */
+    static tuple< QString, int, QStringList > ReplaceInFile( const QString &search_regex,
+                                                             const QString &replacement,
+                                                             Resource* resource,
+                                                             SearchType search_type );
+
+    static tuple< QString, int, QStringList > ReplaceHTMLInFile( const QString &search_regex,
+                                                                 const QString &replacement,
+                                                                 HTMLResource* html_resource,
+                                                                 SearchType search_type );
+
+    static tuple< QString, int, QStringList > ReplaceTextInFile( const QString &search_regex,
+                                                                 const QString &replacement,
+                                                                 TextResource* text_resource );
 
     static tuple< QString, int > PerformGlobalReplace( const QString &text,
                                          const QString &search_regex,
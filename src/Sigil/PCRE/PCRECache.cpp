@@ -19,17 +19,21 @@
 **
 *************************************************************************/
 
+#include <QtCore/QThreadStorage>
+
 #include "PCRE/PCRECache.h"
 
-PCRECache *PCRECache::m_instance = 0;
+// The cache of each thread. QThreadStorage deletes
+// the cache when its thread exits.
+static QThreadStorage<PCRECache*> s_instances;
 
 PCRECache *PCRECache::instance()
 {
-    if (m_instance == 0) {
-        m_instance = new PCRECache();
+    if (!s_instances.hasLocalData()) {
+        s_instances.setLocalData(new PCRECache());
     }
 
-    return m_instance;
+    return s_instances.localData();
 }
 
 PCRECache::PCRECache()
@@ -37,6 +41,11 @@ PCRECache::PCRECache()
 
 }
 
+PCRECache::~PCRECache()
+{
+
+}
+
 bool PCRECache::insert(const QString &key, SPCRE *object)
 {
     return m_cache.insert(key, object);
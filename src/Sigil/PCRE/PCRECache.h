@@ -30,15 +30,19 @@
 #include "PCRE/SPCRE.h"
 
 /**
- * Singleton. A cache of SPCRE regular expression objects.
+ * Per-thread singleton. A cache of SPCRE regular expression objects.
  *
- * The SPCRE's are cached to improve performance.
+ * The SPCRE's are cached to improve performance. Every thread gets
+ * its own cache so searches can run in worker threads without
+ * locking, and without one thread evicting (and deleting) an SPCRE
+ * another thread is still using.
  */
 class PCRECache
 {
 public:
     /**
-     * The accessor function to access the cache.
+     * The accessor function to access the cache
+     * of the calling thread.
      */
     static PCRECache *instance();
     ~PCRECache();
@@ -71,8 +75,6 @@ private:
 
     // The cache that we store the SPCRE's.
     QCache<QString, SPCRE> m_cache;
-    // The single instance of the cache.
-    static PCRECache *m_instance;
 };
 
 #endif // PCRECACHE_H
@@ -19,6 +19,9 @@
 **
 *************************************************************************/
 
+#include <QtCore/QThreadStorage>
+
+#include "Misc/Utility.h"
 #include "PCRE/SPCRE.h"
 #include "PCRE/PCREReplaceTextBuilder.h"
 #include "sigil_constants.h"
@@ -26,6 +29,329 @@
 // The maximum number of catpures that we will allow.
 const int PCRE_MAX_CAPTURE_GROUPS = 30;
 
+// The initial and the maximum size of the JIT stack of a thread.
+// The default stack PCRE uses is only 32K, which isn't enough for
+// repeated groups across a large file. The stack only grows as
+// needed, so a generous maximum costs nothing for simple patterns.
+const int JIT_STACK_START_SIZE = 32 * 1024;
+const int JIT_STACK_MAX_SIZE = 8 * 1024 * 1024;
+
+// Owns the JIT stack of one thread.
+struct JitStack
+{
+    JitStack() : stack(pcre16_jit_stack_alloc(JIT_STACK_START_SIZE, JIT_STACK_MAX_SIZE)) {}
+    ~JitStack() {
+        if (stack != NULL) {
+            pcre16_jit_stack_free(stack);
+        }
+    }
+
+    pcre16_jit_stack *stack;
+};
+
+// SPCRE objects can be used from several threads, but a
+// JIT stack can only be used by one thread at a time.
+// So every thread gets its own stack.
+static QThreadStorage<JitStack*> s_JitStacks;
+
+// The callback PCRE uses to get the JIT stack for a match.
+// Returning NULL makes PCRE use its (small) default stack.
+static pcre16_jit_stack *GetJitStack(void *)
+{
+    if (!s_JitStacks.hasLocalData()) {
+        s_JitStacks.setLocalData(new JitStack());
+    }
+
+    return s_JitStacks.localData()->stack;
+}
+
+// Characters that have a special meaning in a pattern
+// outside of a character class.
+const QString PATTERN_METACHARACTERS = "\\^$.|?*+()[]{}";
+
+// Escape sequences that are followed by more than one character
+// of the sequence, like \x41 or \k<name>, or that quote text.
+const QString LONG_ESCAPE_SEQUENCES = "cxokgpPQE0123456789";
+
+// Skips the option settings at the start of the pattern, like (?i)
+// or (?sU), for the options that don't change what a literal matches.
+// Returns the index of the first character after them. Any other
+// group is left for the caller to deal with.
+static int SkipLeadingOptions(const QString &pattern, bool &caseless)
+{
+    caseless = false;
+
+    int i = 0;
+    while (pattern.mid(i, 2) == "(?") {
+        int options_end = pattern.indexOf(')', i);
+        if (options_end == -1) {
+            break;
+        }
+
+        QString options = pattern.mid(i + 2, options_end - i - 2);
+        bool literal_options = true;
+        foreach (QChar option, options) {
+            if (option != 'i' && option != 's' && option != 'U') {
+                literal_options = false;
+            }
+        }
+        if (!literal_options) {
+            break;
+        }
+
+        caseless = caseless || options.contains('i');
+        i = options_end + 1;
+    }
+
+    return i;
+}
+
+// Checks if the pattern only matches one literal string, as the patterns
+// created for normal searches do. Leading option settings for the options
+// that don't change what a literal matches, like (?i) or (?sU), are allowed.
+// Caseless literals have to be ASCII: PCRE and QString don't agree
+// on the other cases of all non-ASCII characters.
+static bool GetPatternLiteral(const QString &pattern, QString &literal, bool &caseless)
+{
+    QString text;
+
+    int i = SkipLeadingOptions(pattern, caseless);
+    for (; i < pattern.length(); i++) {
+        QChar c = pattern.at(i);
+
+        if (c == '\\') {
+            // A backslash followed by a letter or digit is
+            // an escape sequence. Anything else is a literal.
+            if (i + 1 == pattern.length() || pattern.at(i + 1).isLetterOrNumber()) {
+                return false;
+            }
+            text.append(pattern.at(++i));
+        }
+        else if (PATTERN_METACHARACTERS.contains(c)) {
+            return false;
+        }
+        else {
+            text.append(c);
+        }
+    }
+
+    if (text.isEmpty()) {
+        return false;
+    }
+
+    if (caseless) {
+        foreach (QChar c, text) {
+            if (c.unicode() > 127) {
+                return false;
+            }
+        }
+    }
+
+    literal = text;
+    return true;
+}
+
+// Collects the runs of literal characters every match of the pattern
+// contains. Only patterns without alternatives are handled, and only the
+// runs outside of groups are used. A character followed by a quantifier
+// ends a run and isn't part of it. Returns false if the pattern is too
+// complex to tell. As in GetPatternLiteral, caseless runs are ASCII only.
+static bool GetRequiredLiterals(const QString &pattern, QStringList &literals)
+{
+    if (pattern.contains('|')) {
+        return false;
+    }
+
+    bool caseless;
+    int i = SkipLeadingOptions(pattern, caseless);
+    QStringList runs;
+    QString run;
+    int depth = 0;
+
+    for (; i < pattern.length(); i++) {
+        QChar c = pattern.at(i);
+
+        if (c == '\\') {
+            if (i + 1 == pattern.length() || LONG_ESCAPE_SEQUENCES.contains(pattern.at(i + 1))) {
+                return false;
+            }
+
+            QChar escaped = pattern.at(++i);
+            if (escaped.isLetterOrNumber() || depth > 0 || (caseless && escaped.unicode() > 127)) {
+                runs.append(run);
+                run.clear();
+            }
+            else {
+                run.append(escaped);
+            }
+        }
+        else if (c == '?' || c == '*' || c == '+' || c == '{') {
+            // The quantified character may not be there (or be
+            // repeated), so it can't be part of the run. A character
+            // outside the BMP takes up both halves of a surrogate pair.
+            bool surrogate_pair = run.length() >= 2 && run.at(run.length() - 1).isLowSurrogate() &&
+                                  run.at(run.length() - 2).isHighSurrogate();
+            run.chop(surrogate_pair ? 2 : 1);
+            runs.append(run);
+            run.clear();
+
+            if (c == '{') {
+                i = pattern.indexOf('}', i);
+                if (i == -1) {
+                    return false;
+                }
+            }
+        }
+        else if (c == '(') {
+            // Options set inside the pattern, and comments, which
+            // can contain anything, would need more work.
+            if (pattern.mid(i, 3) == "(?#") {
+                return false;
+            }
+            if (pattern.mid(i, 2) == "(?") {
+                int j = i + 2;
+                while (j < pattern.length() && (pattern.at(j).isLetter() || pattern.at(j) == '-')) {
+                    if (pattern.at(j) == 'i' || pattern.at(j) == 'x') {
+                        return false;
+                    }
+                    j++;
+                }
+            }
+
+            runs.append(run);
+            run.clear();
+            depth++;
+        }
+        else if (c == ')') {
+            runs.append(run);
+            run.clear();
+            if (--depth < 0) {
+                return false;
+            }
+        }
+        else if (c == '[') {
+            runs.append(run);
+            run.clear();
+
+            // Skip the character class. A ] right at the start is part of it.
+            int j = i + 1;
+            if (j < pattern.length() && pattern.at(j) == '^') {
+                j++;
+            }
+            if (j < pattern.length() && pattern.at(j) == ']') {
+                j++;
+            }
+            while (j < pattern.length() && pattern.at(j) != ']') {
+                j += pattern.at(j) == '\\' ? 2 : 1;
+            }
+            if (j >= pattern.length()) {
+                return false;
+            }
+            i = j;
+        }
+        else if (PATTERN_METACHARACTERS.contains(c) || depth > 0 || (caseless && c.unicode() > 127)) {
+            runs.append(run);
+            run.clear();
+        }
+        else {
+            run.append(c);
+        }
+    }
+    runs.append(run);
+
+    literals.clear();
+    foreach (const QString &text, runs) {
+        if (!text.isEmpty()) {
+            literals.append(text);
+        }
+    }
+
+    return !literals.isEmpty();
+}
+
+// Collects the match information of every match.
+struct EveryMatchVisitor : public SPCRE::MatchVisitor
+{
+    bool visitMatch(const int *ovector, int capture_count) {
+        info.append(SPCRE::generateMatchInfo(ovector, capture_count));
+        return true;
+    }
+
+    QList<SPCRE::MatchInfo> info;
+};
+
+// Only lets the matches be counted.
+struct CountVisitor : public SPCRE::MatchVisitor
+{
+    bool visitMatch(const int *, int) {
+        return true;
+    }
+};
+
+// Keeps the match information of the first match and stops.
+struct FirstMatchVisitor : public SPCRE::MatchVisitor
+{
+    bool visitMatch(const int *ovector, int capture_count) {
+        match_info = SPCRE::generateMatchInfo(ovector, capture_count);
+        return false;
+    }
+
+    SPCRE::MatchInfo match_info;
+};
+
+// Keeps the offsets of the latest match. Copying them is
+// cheaper than building the MatchInfo of every match.
+struct LastMatchVisitor : public SPCRE::MatchVisitor
+{
+    LastMatchVisitor() : capture_count(-1) {}
+
+    bool visitMatch(const int *ovector, int count) {
+        capture_count = count;
+        memcpy(last_ovector, ovector, sizeof(int) * (1 + count) * 2);
+        return true;
+    }
+
+    SPCRE::MatchInfo lastMatchInfo() const {
+        if (capture_count == -1) {
+            return SPCRE::MatchInfo();
+        }
+        return SPCRE::generateMatchInfo(last_ovector, capture_count);
+    }
+
+    int last_ovector[(1 + PCRE_MAX_CAPTURE_GROUPS) * 2];
+    int capture_count;
+};
+
+// Appends the text before each match and its replacement to out.
+struct ReplaceAllVisitor : public SPCRE::MatchVisitor
+{
+    ReplaceAllVisitor(SPCRE &spcre, const QString &text, const QString &replacement_pattern, QString &out)
+        : spcre(spcre), text(text), replacement_pattern(replacement_pattern), out(out), count(0), copied_offset(0) {}
+
+    bool visitMatch(const int *ovector, int capture_count) {
+        SPCRE::MatchInfo match_info = SPCRE::generateMatchInfo(ovector, capture_count);
+        const std::pair<int, int> &offset = match_info.offset;
+
+        if (builder.BuildReplacementText(spcre, Utility::Substring(offset.first, offset.second, text), match_info.capture_groups_offsets, replacement_pattern, replaced_text)) {
+            out.append(text.midRef(copied_offset, offset.first - copied_offset));
+            out.append(replaced_text);
+            copied_offset = offset.second;
+            count++;
+        }
+        return true;
+    }
+
+    SPCRE &spcre;
+    const QString &text;
+    const QString &replacement_pattern;
+    QString &out;
+    PCREReplaceTextBuilder builder;
+    QString replaced_text;
+    int count;
+    // The end of the text we have already copied to the output.
+    int copied_offset;
+};
+
 SPCRE::SPCRE(const QString &patten)
 {
     m_pattern = patten;
@@ -33,6 +359,8 @@ SPCRE::SPCRE(const QString &patten)
     m_re = NULL;
     m_study = NULL;
     m_captureSubpatternCount = 0;
+    m_literalCaseless = false;
+    m_minLength = 0;
 
     const char *error;
     int erroroffset;
@@ -42,10 +370,48 @@ SPCRE::SPCRE(const QString &patten)
     if (m_re != NULL) {
         m_valid = true;
         // Study the pattern and save the results of the study.
-        m_study = pcre16_study(m_re, 0, &error);
+        // This also JIT compiles the pattern; pcre16_exec falls back
+        // to the interpreter for patterns the JIT can't handle.
+        // We don't rerun matches that fail with PCRE_ERROR_JIT_STACKLIMIT
+        // in the interpreter: it needs several times more (C) stack
+        // for the same match and would just crash the thread instead.
+        m_study = pcre16_study(m_re, PCRE_STUDY_JIT_COMPILE, &error);
+
+        if (m_study != NULL) {
+            pcre16_assign_jit_stack(m_study, GetJitStack, NULL);
+        }
 
         // Store the number of capture subpatterns.
         pcre16_fullinfo(m_re, m_study, PCRE_INFO_CAPTURECOUNT, &m_captureSubpatternCount);
+
+        // Store what canMatch needs to rule out texts. PCRE doesn't
+        // tell us if the required characters have to be matched
+        // ignoring case, so canMatch always ignores case for them
+        // and we only use ASCII characters (see GetPatternLiteral).
+        // The literal text every match contains is kept for search indexes.
+        if (GetPatternLiteral(m_pattern, m_literal, m_literalCaseless)) {
+            m_requiredLiterals.append(m_literal);
+        }
+        else {
+            GetRequiredLiterals(m_pattern, m_requiredLiterals);
+
+            int first_char = -1;
+            int last_literal = -1;
+            pcre16_fullinfo(m_re, m_study, PCRE_INFO_FIRSTCHAR, &first_char);
+            pcre16_fullinfo(m_re, m_study, PCRE_INFO_LASTLITERAL, &last_literal);
+
+            // Negative values mean there is no such character.
+            if (first_char >= 0 && first_char <= 127) {
+                m_requiredChars.append(QChar(first_char));
+            }
+            if (last_literal >= 0 && last_literal <= 127 && last_literal != first_char) {
+                m_requiredChars.append(QChar(last_literal));
+            }
+        }
+
+        if (m_study != NULL) {
+            pcre16_fullinfo(m_re, m_study, PCRE_INFO_MINLENGTH, &m_minLength);
+        }
     }
     // Pattern is not valid.
     else {
@@ -60,7 +426,7 @@ SPCRE::~SPCRE()
         m_re = NULL;
     }
     if (m_study != NULL) {
-        pcre16_free(m_study);
+        pcre16_free_study(m_study);
         m_study = NULL;
     }
 }
@@ -103,19 +469,45 @@ int SPCRE::getCaptureStringNumber(const QString &name)
     return number;
 }
 
+QStringList SPCRE::getRequiredLiterals()
+{
+    return m_requiredLiterals;
+}
+
+bool SPCRE::canMatch(const QString &text)
+{
+    if (m_re == NULL || text.length() < m_minLength) {
+        return false;
+    }
+
+    if (!m_literal.isEmpty()) {
+        return text.contains(m_literal, m_literalCaseless ? Qt::CaseInsensitive : Qt::CaseSensitive);
+    }
+
+    foreach (QChar required_char, m_requiredChars) {
+        if (!text.contains(required_char, Qt::CaseInsensitive)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
 QList<SPCRE::MatchInfo> SPCRE::getEveryMatchInfo(const QString &text)
 {
-    // This function is very similar to getNextMatchInfo but we don't
-    // want to put a call to getNextMatchInfo in a loop because it allocates
-    // a new ovector. We want to avoid this and only do one allocation so we
-    // reuse the logic and put the call to generateMatchInfo in the loop.
-    QList<SPCRE::MatchInfo> info;
+    EveryMatchVisitor visitor;
+    forEachMatch(text.constData(), text.length(), visitor);
+    return visitor.info;
+}
 
-    if (m_re == NULL || text.isEmpty()) {
-        return info;
+int SPCRE::forEachMatch(const QChar *text, int length, MatchVisitor &visitor)
+{
+    if (m_re == NULL || length == 0 || !canMatch(QString::fromRawData(text, length))) {
+        return 0;
     }
 
     int rc = 0;
+    int count = 0;
     // Set the size of the array based on the number of capture subpatterns
     // if it does not exceed our maximum size.
     int ovector_count = getCaptureSubpatternCount();
@@ -125,15 +517,14 @@ QList<SPCRE::MatchInfo> SPCRE::getEveryMatchInfo(const QString &text)
     // The vector needs to be a multiple of 3 and have at least one location
     // for the full matched string.
     int ovector_size = (1 + ovector_count) * 3;
-    // Allocate only the amount of memory we need for the search pattern and
-    // the number of capture patterns it contains.
-    // Can't use dynamic array alloction (int ovector[ovector_size]) because
-    // MSVC doesn't support it.
-    int *ovector = new int[ovector_size];
+    // A vector large enough for any pattern lives on the stack and is
+    // reused for every match, so nothing is allocated while searching.
+    int ovector[(1 + PCRE_MAX_CAPTURE_GROUPS) * 3];
     memset(ovector, 0, sizeof(int)*ovector_size);
     // We keep track of the last offsets as we move though the string matching
     // sub strings.
     int last_offset[2] = {0};
+    PCRE_SPTR16 subject = reinterpret_cast<PCRE_SPTR16>(text);
 
     // Run until no matches are found.
     do {
@@ -144,63 +535,43 @@ QList<SPCRE::MatchInfo> SPCRE::getEveryMatchInfo(const QString &text)
 
         // We only care about matches that have text in it.
         if (last_offset[0] != last_offset[1]) {
-            // Add the matched information to the list.
-            info.append(generateMatchInfo(ovector, ovector_count));
+            count++;
+            if (!visitor.visitMatch(ovector, ovector_count)) {
+                break;
+            }
         }
 
-        rc = pcre16_exec(m_re, m_study, text.utf16(), text.length(), last_offset[1], 0, ovector, ovector_size);
+        rc = pcre16_exec(m_re, m_study, subject, length, last_offset[1], 0, ovector, ovector_size);
     } while(rc >= 0 && ovector[0] != ovector[1] && ovector[1] != last_offset[1] && ovector[0] < ovector[1]);
 
-    delete[] ovector;
-    return info;
+    return count;
 }
 
-SPCRE::MatchInfo SPCRE::getFirstMatchInfo(const QString &text)
+int SPCRE::countMatches(const QString &text)
 {
-    SPCRE::MatchInfo match_info;
-
-    if (m_re == NULL || text.isEmpty()) {
-        return match_info;
-    }
-
-    int rc = 0;
-    // Set the size of the array based on the number of capture subpatterns
-    // if it does not exceed our maximum size.
-    int ovector_count = getCaptureSubpatternCount();
-    if (ovector_count > PCRE_MAX_CAPTURE_GROUPS) {
-        ovector_count = PCRE_MAX_CAPTURE_GROUPS;
-    }
-    // The vector needs to be a multiple of 3 and have at least one location
-    // for the full matched string.
-    int ovector_size = (1 + ovector_count) * 3;
-    // Allocate only the amount of memory we need for the search pattern and
-    // the number of capture patterns it contains.
-    // Can't use dynamic array alloction (int ovector[ovector_size]) because
-    // MSVC doesn't support it.
-    int *ovector = new int[ovector_size];
-    memset(ovector, 0, sizeof(int)*ovector_size);
-
-    rc = pcre16_exec(m_re, m_study, text.utf16(), text.length(), 0, 0, ovector, ovector_size);
+    CountVisitor visitor;
+    return forEachMatch(text.constData(), text.length(), visitor);
+}
 
-    if (rc >= 0 && ovector[0] != ovector[1]) {
-        match_info = generateMatchInfo(ovector, ovector_count);
-    }
+SPCRE::MatchInfo SPCRE::getFirstMatchInfo(const QString &text)
+{
+    return getFirstMatchInfo(text.constData(), text.length());
+}
 
-    delete[] ovector;
-    return match_info;
+SPCRE::MatchInfo SPCRE::getFirstMatchInfo(const QChar *text, int length)
+{
+    FirstMatchVisitor visitor;
+    forEachMatch(text, length, visitor);
+    return visitor.match_info;
 }
 
 SPCRE::MatchInfo SPCRE::getLastMatchInfo(const QString &text)
 {
-    QList<SPCRE::MatchInfo> info;
-
-    info = getEveryMatchInfo(text);
-
-    if (!info.isEmpty()) {
-        return info.last();
-    } else {
-        return SPCRE::MatchInfo();
-    }
+    // Matches are found front to back, so we still have to go through
+    // all of them. But we only build the MatchInfo of the last one.
+    LastMatchVisitor visitor;
+    forEachMatch(text.constData(), text.length(), visitor);
+    return visitor.lastMatchInfo();
 }
 
 bool SPCRE::replaceText(const QString &text, const QList<std::pair<int, int> > &capture_groups_offsets, const QString &replacement_pattern, QString &out)
@@ -209,7 +580,20 @@ bool SPCRE::replaceText(const QString &text, const QList<std::pair<int, int> > &
     return builder.BuildReplacementText(*this, text, capture_groups_offsets, replacement_pattern, out);
 }
 
-SPCRE::MatchInfo SPCRE::generateMatchInfo(int ovector[], int ovector_count)
+int SPCRE::replaceAll(const QString &text, const QString &replacement_pattern, QString &out)
+{
+    out.clear();
+    out.reserve(text.length());
+
+    ReplaceAllVisitor visitor(*this, text, replacement_pattern, out);
+    forEachMatch(text.constData(), text.length(), visitor);
+
+    out.append(text.midRef(visitor.copied_offset));
+
+    return visitor.count;
+}
+
+SPCRE::MatchInfo SPCRE::generateMatchInfo(const int ovector[], int ovector_count)
 {
     MatchInfo match_info;
 
@@ -29,6 +29,7 @@
 
 #include <QtCore/QList>
 #include <QtCore/QString>
+#include <QtCore/QStringList>
 
 using std::pair;
 
@@ -72,6 +73,28 @@ public:
         }
     };
 
+    /**
+     * Receives the matches found by forEachMatch.
+     */
+    class MatchVisitor {
+    public:
+        virtual ~MatchVisitor() {}
+
+        /**
+         * Called for every match, in the order they are found.
+         *
+         * @param ovector The offsets of the match within the text, and of
+         * its capture groups, as PCRE returns them: ovector[0] and
+         * ovector[1] are the start and end of the match, the following
+         * pairs are those of the capture groups. The vector is reused
+         * for the next match, so it's only valid during the call.
+         * @param capture_count The number of capture groups in ovector.
+         *
+         * @return false to stop looking for matches.
+         */
+        virtual bool visitMatch(const int *ovector, int capture_count) = 0;
+    };
+
     /**
      * Is the pattern valid.
      *
@@ -114,6 +137,29 @@ public:
      */
     int getCaptureStringNumber(const QString &name);
 
+    /**
+     * The runs of literal text every match contains, as far as they
+     * can be told from the pattern. Used to look the pattern up in
+     * a search index without running it. If the pattern ignores
+     * case, the runs only contain ASCII characters.
+     *
+     * @return The literal runs. Empty if nothing is known.
+     */
+    QStringList getRequiredLiterals();
+
+    /**
+     * Quickly rules out texts the pattern can't match. Only looks
+     * for text the pattern requires: the whole pattern if it's a
+     * plain literal (as the patterns for normal searches are), or
+     * the characters PCRE reports every match must contain.
+     * So it never rules out a text the pattern could match.
+     *
+     * @param text The text to check.
+     *
+     * @return False if the pattern can't match anywhere in the text.
+     */
+    bool canMatch(const QString &text);
+
     /**
      * Generate match information from a segment of text. Finds all matching
      * instances of pattern within the given text.
@@ -123,7 +169,41 @@ public:
      * @return A list of MatchInfo objects.
      */
     QList<MatchInfo> getEveryMatchInfo(const QString &text);
+
+    /**
+     * Finds every match of the pattern within the given text and hands
+     * them to a visitor, without allocating anything per match. Matches
+     * are found the same way getEveryMatchInfo finds them.
+     *
+     * @param text The start of the text to search.
+     * @param length The length of the text.
+     * @param visitor The visitor to call for every match.
+     *
+     * @return The number of matches visited.
+     */
+    int forEachMatch(const QChar *text, int length, MatchVisitor &visitor);
+
+    /**
+     * Counts the matches within the given text. Nothing
+     * is built for the matches, they are only counted.
+     *
+     * @param text The text to search.
+     *
+     * @return The number of matches.
+     */
+    int countMatches(const QString &text);
+
     MatchInfo getFirstMatchInfo(const QString &text);
+    /**
+     * Finds the first match within a span of text, without
+     * copying the span. Offsets are relative to the span.
+     *
+     * @param text The start of the text to search.
+     * @param length The length of the text.
+     *
+     * @return The match information, or an empty MatchInfo.
+     */
+    MatchInfo getFirstMatchInfo(const QChar *text, int length);
     MatchInfo getLastMatchInfo(const QString &text);
 
     /**
@@ -142,8 +222,33 @@ public:
      */
     bool replaceText(const QString &text, const QList<std::pair<int, int> > &capture_groups_offsets, const QString &replacement_pattern, QString &out);
 
+    /**
+     * Replaces every match within the given text using a replacement
+     * pattern. The new text is built in a single pass, copying over the
+     * text between the matches only once, so this takes linear time
+     * no matter how many matches there are.
+     *
+     * @param text The text to search.
+     * @param replacement_pattern The pattern / text to use to create the
+     * replacement text for each match.
+     * @param[out] out The text with all the replacements made.
+     *
+     * @return The number of replacements made.
+     */
+    int replaceAll(const QString &text, const QString &replacement_pattern, QString &out);
+
+    /**
+     * Builds the match information of a match from the
+     * ovector a MatchVisitor is given.
+     *
+     * @param ovector The offsets of the match and its capture groups.
+     * @param ovector_count The number of capture groups in ovector.
+     *
+     * @return The match information.
+     */
+    static MatchInfo generateMatchInfo(const int ovector[], int ovector_count);
+
 private:
-    MatchInfo generateMatchInfo(int ovector[], int ovector_count);
 
     // Store if the pattern is valid.
     bool m_valid;
@@ -155,6 +260,16 @@ private:
     pcre16_extra *m_study;
     // The number of capture subpatterns with the expression.
     int m_captureSubpatternCount;
+    // The text every match is, if the pattern is a plain literal.
+    QString m_literal;
+    // Whether the literal has to be matched ignoring case.
+    bool m_literalCaseless;
+    // Runs of literal text every match contains.
+    QStringList m_requiredLiterals;
+    // Characters every match contains.
+    QList<QChar> m_requiredChars;
+    // The length every match has at least.
+    int m_minLength;
 };
 
 #endif // SPCRE_H
@@ -30,6 +30,7 @@
 #include "BookManipulation/GuideSemantics.h"
 #include "BookManipulation/XercesCppUse.h"
 #include "BookManipulation/XhtmlDoc.h"
+#include "Misc/SettingsStore.h"
 #include "Misc/Utility.h"
 #include "ResourceObjects/HTMLResource.h"
 #include "sigil_exception.h"
@@ -47,7 +48,8 @@ HTMLResource::HTMLResource( const QString &fullfilepath,
                             QObject *parent )
     :
     XMLResource( fullfilepath, parent ),
-    m_Resources( resources )
+    m_Resources( resources ),
+    m_CleanGeneration( -1 )
 {
 
 }
@@ -61,7 +63,7 @@ Resource::ResourceType HTMLResource::Type() const
 void HTMLResource::SetText(const QString &text)
 {
     emit TextChanging();
-    XMLResource::SetText(CleanSource::Clean(text));
+    CleanAndSetText(text);
 
     // Track resources whose change will necessitate an update of the BV and PV.
     // At present this only applies to css files and images.
@@ -69,9 +71,34 @@ void HTMLResource::SetText(const QString &text)
 }
 
 
+void HTMLResource::SetText(const QString &text, const QStringList &linked_resource_paths)
+{
+    emit TextChanging();
+    CleanAndSetText(text);
+
+    // Cleaning doesn't touch the link and img paths,
+    // so the caller's list is still valid.
+    TrackNewResources(linked_resource_paths);
+}
+
+
+void HTMLResource::SetUpdatedText(const QString &text, const QStringList &linked_resource_paths)
+{
+    emit TextChanging();
+    XMLResource::SetText(text);
+    TrackNewResources(linked_resource_paths);
+}
+
+
 void HTMLResource::SaveToDisk(bool book_wide_save)
 {
-    SetText(CleanSource::PrettyPrint(GetText()));
+    QString text = GetText();
+
+    // Cleaned text is already pretty printed; only text changed
+    // since the last Clean() needs another round through Tidy.
+    if ( m_CleanGeneration != GetModificationGeneration() )
+
+        SetText(CleanSource::PrettyPrint(text));
 
     XMLResource::SaveToDisk(book_wide_save);
 }
@@ -87,18 +114,24 @@ QStringList HTMLResource::SplitOnSGFChapterMarkers()
 {
     QStringList chapters = XhtmlDoc::GetSGFChapterSplits(GetText());
 
-    SetText(CleanSource::Clean(chapters.takeFirst()));
+    SetText(chapters.takeFirst());
 
     return chapters;
 }
 
 
 QStringList HTMLResource::GetPathsToLinkedResources()
+{
+    shared_ptr<xc::DOMDocument> d = XhtmlDoc::LoadTextIntoDocument(GetText());
+
+    return GetPathsToLinkedResources(*d.get());
+}
+
+
+QStringList HTMLResource::GetPathsToLinkedResources(const xc::DOMDocument &document)
 {
     QStringList linked_resources;
 
-    shared_ptr<xc::DOMDocument> d = XhtmlDoc::LoadTextIntoDocument(GetText());
-    xc::DOMDocument &document = *d.get();
     QStringList tags = QStringList() << "link" << "img";
     Q_FOREACH(QString tag, tags) {
         xc::DOMNodeList *elems = document.getElementsByTagName( QtoX( tag ) );
@@ -153,3 +186,14 @@ void HTMLResource::TrackNewResources(const QStringList &filepaths)
         }
     }
 }
+
+
+void HTMLResource::CleanAndSetText(const QString &text)
+{
+    XMLResource::SetText(CleanSource::Clean(text));
+
+    // With cleaning turned off the text is stored as is,
+    // so it still needs pretty printing when saved.
+    SettingsStore settings;
+    m_CleanGeneration = settings.cleanLevel() != SettingsStore::CleanLevel_Off ? GetModificationGeneration() : -1;
+}
@@ -68,6 +68,30 @@ public:
 
     virtual void SetText(const QString &text);
 
+    /**
+     * Sets the text of the resource. The caller provides the paths
+     * to the linked resources of the new text, so the text doesn't
+     * have to be parsed again to find them. Use this when the text 
+     * was just serialized from a DOM.
+     *
+     * @param text The new text.
+     * @param linked_resource_paths The paths to the linked resources
+     *                              like images and stylesheets, as returned
+     *                              by GetPathsToLinkedResources( document ).
+     */
+    void SetText(const QString &text, const QStringList &linked_resource_paths);
+
+    /**
+     * Sets text that was serialized from the DOM of clean source after
+     * path updates (see PerformHTMLUpdates). Path updates only change
+     * attribute values and CSS, so the text is not cleaned again.
+     *
+     * @param text The new text.
+     * @param linked_resource_paths The paths to the linked resources
+     *                              of the new text.
+     */
+    void SetUpdatedText(const QString &text, const QStringList &linked_resource_paths);
+
     void SaveToDisk(bool book_wide_save=false);
 
     /**
@@ -88,6 +112,15 @@ public:
      */
     QStringList GetPathsToLinkedResources();
 
+    /**
+     * Returns the paths to all the linked resources
+     * like images and stylesheets in the provided document.
+     *
+     * @param document The XHTML document to search.
+     * @return The paths to the linked resources.
+     */
+    static QStringList GetPathsToLinkedResources(const xc::DOMDocument &document);
+
     /**
      * Returns the paths to all the linked stylesheets
      *
@@ -107,6 +140,15 @@ private:
      */
     void TrackNewResources( const QStringList &filepaths );
 
+    /**
+     * Cleans the text and sets it as the text of the resource.
+     * Remembers the modification generation of the cleaned text
+     * so SaveToDisk knows whether it needs pretty printing.
+     *
+     * @param text The new text.
+     */
+    void CleanAndSetText( const QString &text );
+
     ///////////////////////////////
     // PRIVATE MEMBER VARIABLES
     ///////////////////////////////
@@ -116,6 +158,12 @@ private:
      * @todo This is ugly as hell. Find a way to remove this.
      */
     const QHash< QString, Resource* > &m_Resources;
+
+    /**
+     * The modification generation at which the text was
+     * last cleaned, or -1 if the current text was never cleaned.
+     */
+    int m_CleanGeneration;
 };
 
 #endif // HTMLRESOURCE_H
@@ -98,7 +98,7 @@ void NCXResource::GenerateNCXFromBookContents( const Book &book )
     ncx.WriteXMLFromHeadings();
     buffer.close();
 
-    SetText( CleanSource::ProcessXML( QString::fromUtf8( raw_ncx.constData(), raw_ncx.size() ) ) );
+    SetText( CleanSource::ProcessXML( raw_ncx ) );
 }
 
 
@@ -112,7 +112,7 @@ void NCXResource::GenerateNCXFromTOCContents( const Book &book, NCXModel &ncx_mo
     ncx.WriteXML();
     buffer.close();
 
-    SetText( CleanSource::ProcessXML( QString::fromUtf8( raw_ncx.constData(), raw_ncx.size() ) ) );
+    SetText( CleanSource::ProcessXML( raw_ncx ) );
 }
 
 
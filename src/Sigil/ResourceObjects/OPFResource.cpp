@@ -93,51 +93,64 @@ Resource::ResourceType OPFResource::Type() const
 GuideSemantics::GuideSemanticType OPFResource::GetGuideSemanticTypeForResource( const Resource &resource ) const
 {
     QReadLocker locker( &GetLock() );
-    shared_ptr< xc::DOMDocument > document = GetDocument();
-    return GetGuideSemanticTypeForResource( resource, *document );
+    shared_ptr< const PackageModel > package = GetPackageModel();
+    QString resource_oebps_path = Utility::URLEncodePath( resource.GetRelativePathToOEBPS() );
+
+    for ( int i = 0; i < package->guide.count(); ++i )
+    {
+        if ( package->guide[ i ].second == resource_oebps_path )
+
+            return GuideSemantics::Instance().MapReferenceTypeToGuideEnum( package->guide[ i ].first );
+    }
+
+    return GuideSemantics::NoType;
 }
 
 
 int OPFResource::GetReadingOrder( const ::HTMLResource &html_resource ) const
 {
     QReadLocker locker( &GetLock() );
-    shared_ptr< xc::DOMDocument > document = GetDocument();
+    shared_ptr< const PackageModel > package = GetPackageModel();
 
     const Resource &resource = *static_cast< const Resource* >( &html_resource );
-    QString resource_id = GetResourceManifestID( resource, *document );
+    QString resource_id = package->href_to_id.value( Utility::URLEncodePath( resource.GetRelativePathToOEBPS() ) );
 
-    QList< xc::DOMElement* > itemrefs = 
-        XhtmlDoc::GetTagMatchingDescendants( *document, "itemref", OPF_XML_NAMESPACE );
+    return package->spine_positions.value( resource_id, -1 );
+}
 
-    for ( int i = 0; i < itemrefs.count(); ++i )
-    {
-        QString idref = XtoQ( itemrefs[ i ]->getAttribute( QtoX( "idref" ) ) );
 
-        if ( resource_id == idref )
+QHash< ::HTMLResource*, int > OPFResource::GetReadingOrders( const QList< ::HTMLResource* > &html_resources ) const
+{
+    QReadLocker locker( &GetLock() );
+    shared_ptr< const PackageModel > package = GetPackageModel();
 
-            return i;
+    QHash< ::HTMLResource*, int > reading_orders;
+
+    foreach( ::HTMLResource *html_resource, html_resources )
+    {
+        const Resource &resource = *static_cast< const Resource* >( html_resource );
+        QString resource_id = package->href_to_id.value( Utility::URLEncodePath( resource.GetRelativePathToOEBPS() ) );
+
+        reading_orders[ html_resource ] = package->spine_positions.value( resource_id, -1 );
     }
 
-    return -1;
+    return reading_orders;
 }
 
 
 QString OPFResource::GetCoverPageOEBPSPath() const
 {
     QReadLocker locker( &GetLock() );
-    shared_ptr< xc::DOMDocument > document = GetDocument();
-    QList< xc::DOMElement* > references = 
-        XhtmlDoc::GetTagMatchingDescendants( *document, "reference", OPF_XML_NAMESPACE );
+    shared_ptr< const PackageModel > package = GetPackageModel();
 
-    foreach( xc::DOMElement* reference, references )
+    for ( int i = 0; i < package->guide.count(); ++i )
     {
-        QString type_text = XtoQ( reference->getAttribute( QtoX( "type" ) ) );
         GuideSemantics::GuideSemanticType current_type =
-            GuideSemantics::Instance().MapReferenceTypeToGuideEnum( type_text );
+            GuideSemantics::Instance().MapReferenceTypeToGuideEnum( package->guide[ i ].first );
 
         if ( current_type == GuideSemantics::Cover )
         {
-            return Utility::URLDecodePath( XtoQ( reference->getAttribute( QtoX( "href" ) ) ) );              
+            return Utility::URLDecodePath( package->guide[ i ].second );
         }
     }
 
@@ -148,20 +161,22 @@ QString OPFResource::GetCoverPageOEBPSPath() const
 QString OPFResource::GetMainIdentifierValue() const
 {
     QReadLocker locker( &GetLock() );
-    shared_ptr< xc::DOMDocument > document = GetDocument();
-    return XtoQ( GetMainIdentifier( *document ).getTextContent() );
+    return GetPackageModel()->main_identifier;
 }
 
 
 void OPFResource::SaveToDisk( bool book_wide_save )
 {
     QString text = GetText();
+    QString original_text = text;
 
     // Work around for covers appearing on the Nook. Issue 942.
     QRegExp flip_meta_cover( "<meta content=\"([^\"]+)\" name=\"cover\"" );
     text = text.replace(flip_meta_cover, "<meta name=\"cover\" content=\"\\1\"");
 
-    SetText( text );
+    if ( text != original_text )
+
+        SetText( text );
 
     TextResource::SaveToDisk( book_wide_save );
 }
@@ -171,57 +186,35 @@ QString OPFResource::GetUUIDIdentifierValue()
     EnsureUUIDIdentifierPresent();
 
     QReadLocker locker( &GetLock() );
-    shared_ptr< xc::DOMDocument > document = GetDocument();
-
-    QList< xc::DOMElement* > identifiers = 
-        XhtmlDoc::GetTagMatchingDescendants( *document, "identifier", DUBLIN_CORE_NS );
-
-    foreach( xc::DOMElement *identifier, identifiers )
-    {
-        QString value = XtoQ( identifier->getTextContent() ).remove( "urn:uuid:" );
-
-        if ( !QUuid( value ).isNull() )
-        {
-            return value;
-        }
-    }
+    QString value = GetPackageModel()->uuid_identifier;
 
     // EnsureUUIDIdentifierPresent should ensure we 
-    // never reach here.
-    Q_ASSERT( false );
-    return QString();
+    // never get an empty value here.
+    Q_ASSERT( !value.isEmpty() );
+    return value;
 }
 
 
 void OPFResource::EnsureUUIDIdentifierPresent()
 {
     QWriteLocker locker( &GetLock() );
-    shared_ptr< xc::DOMDocument > document = GetDocument();
 
-    QList< xc::DOMElement* > identifiers = 
-        XhtmlDoc::GetTagMatchingDescendants( *document, "identifier", DUBLIN_CORE_NS );
+    if ( !GetPackageModel()->uuid_identifier.isEmpty() )
 
-    foreach( xc::DOMElement *identifier, identifiers )
-    {
-        QString value = XtoQ( identifier->getTextContent() ).remove( "urn:uuid:" );
+        return;
 
-        if ( !QUuid( value ).isNull() )
-        {
-            return;
-        }
-    }
-    
+    shared_ptr< xc::DOMDocument > document = TakeDocument();
     QString uuid = Utility::CreateUUID();
 
     WriteIdentifier( "UUID", uuid, *document );
-    UpdateTextFromDom( *document );    
+    CommitDocument( document );
 }
 
 
 void OPFResource::UpdateNCXLocationInManifest( const ::NCXResource &ncx )
 {
     QWriteLocker locker( &GetLock() );
-    shared_ptr< xc::DOMDocument > document = GetDocument();
+    shared_ptr< xc::DOMDocument > document = TakeDocument();
 
     xc::DOMElement &spine = GetSpineElement( *document );
     QString ncx_id = XtoQ( spine.getAttribute( QtoX( "toc" ) ) );
@@ -240,14 +233,14 @@ void OPFResource::UpdateNCXLocationInManifest( const ::NCXResource &ncx )
         }
     }
    
-    UpdateTextFromDom( *document );  
+    CommitDocument( document );
 }
 
 
 void OPFResource::AddSigilVersionMeta()
 {
     QWriteLocker locker( &GetLock() );
-    shared_ptr< xc::DOMDocument > document = GetDocument();
+    shared_ptr< xc::DOMDocument > document = TakeDocument();
 
     QList< xc::DOMElement* > metas = 
         XhtmlDoc::GetTagMatchingDescendants( *document, "meta", OPF_XML_NAMESPACE );
@@ -259,7 +252,7 @@ void OPFResource::AddSigilVersionMeta()
         if ( name == SIGIL_VERSION_META_NAME )
         {
             meta->setAttribute( QtoX( "content" ), QtoX( SIGIL_VERSION ) );
-            UpdateTextFromDom( *document );  
+            CommitDocument( document );
             return;
         }
     }
@@ -271,17 +264,21 @@ void OPFResource::AddSigilVersionMeta()
     xc::DOMElement &metadata = GetMetadataElement( *document );
     metadata.appendChild( element );
 
-    UpdateTextFromDom( *document );    
+    CommitDocument( document );
 }
 
 
 bool OPFResource::IsCoverImage( const ::ImageResource &image_resource ) const
 {
     QReadLocker locker( &GetLock() );
+    shared_ptr< const PackageModel > package = GetPackageModel();
+
+    if ( !package->has_cover_meta )
 
-    shared_ptr< xc::DOMDocument > document = GetDocument();
+        return false;
 
-    return IsCoverImageCheck( image_resource, *document );
+    QString resource_oebps_path = Utility::URLEncodePath( image_resource.GetRelativePathToOEBPS() );
+    return package->cover_meta_content == package->href_to_id.value( resource_oebps_path );
 }
 
 bool OPFResource::IsCoverImageCheck(const Resource &resource, xc::DOMDocument &document) const
@@ -306,10 +303,7 @@ bool OPFResource::IsCoverImageCheck(QString resource_id, xc::DOMDocument &docume
 bool OPFResource::CoverImageExists() const
 {
     QReadLocker locker( &GetLock() );
-
-    shared_ptr< xc::DOMDocument > document = GetDocument();
-    
-    return GetCoverMeta( *document ) != NULL;
+    return GetPackageModel()->has_cover_meta;
 }
 
 
@@ -317,40 +311,23 @@ void OPFResource::AutoFixWellFormedErrors()
 {
     QWriteLocker locker( &GetLock() );
 
-    UpdateTextFromDom( *CreateOPFFromScratch() );
+    CommitDocument( CreateOPFFromScratch() );
 }
 
 
 QStringList OPFResource::GetSpineOrderFilenames() const
 {
     QReadLocker locker( &GetLock() );
-    shared_ptr< xc::DOMDocument > document = GetDocument();
-
-    QList< xc::DOMElement* > items = 
-        XhtmlDoc::GetTagMatchingDescendants( *document, "item", OPF_XML_NAMESPACE );
-
-    QHash< QString, QString > id_to_filename_mapping;
-
-    foreach( xc::DOMElement* item, items )
-    {
-        QString id   = XtoQ( item->getAttribute( QtoX( "id" ) ) );
-        QString href = XtoQ( item->getAttribute( QtoX( "href" ) ) );
-
-        id_to_filename_mapping[ id ] = QFileInfo( href ).fileName();
-    }
-
-    QList< xc::DOMElement* > itemrefs = 
-        XhtmlDoc::GetTagMatchingDescendants( *document, "itemref", OPF_XML_NAMESPACE );
+    shared_ptr< const PackageModel > package = GetPackageModel();
 
     QStringList filenames_in_reading_order;
     
-    foreach( xc::DOMElement* itemref, itemrefs )
+    foreach( const QString &idref, package->spine )
     {
-        QString idref = XtoQ( itemref->getAttribute( QtoX( "idref" ) ) );
+        if ( package->id_to_href.contains( idref ) )
 
-        if ( id_to_filename_mapping.contains( idref ) )
-
-           filenames_in_reading_order.append( Utility::URLDecodePath( id_to_filename_mapping[ idref ] ) );
+           filenames_in_reading_order.append( 
+               Utility::URLDecodePath( QFileInfo( package->id_to_href.value( idref ) ).fileName() ) );
     }
 
     return filenames_in_reading_order;
@@ -360,7 +337,7 @@ QStringList OPFResource::GetSpineOrderFilenames() const
 void OPFResource::SetSpineOrderFromFilenames( const QStringList spineOrder )
 {
     QWriteLocker locker( &GetLock() );
-    shared_ptr< xc::DOMDocument > document = GetDocument();
+    shared_ptr< xc::DOMDocument > document = TakeDocument();
 
     QList< xc::DOMElement* > items =
             XhtmlDoc::GetTagMatchingDescendants( *document, "item", OPF_XML_NAMESPACE );
@@ -403,31 +380,14 @@ void OPFResource::SetSpineOrderFromFilenames( const QStringList spineOrder )
         spine.appendChild( spineWriter.next() );
     }
 
-    UpdateTextFromDom( *document );
+    CommitDocument( document );
 }
 
 
 QList< Metadata::MetaElement > OPFResource::GetDCMetadata() const
 {
     QReadLocker locker( &GetLock() );
-    shared_ptr< xc::DOMDocument > document = GetDocument();
-    QList< xc::DOMElement* > dc_elements = 
-        XhtmlDoc::GetTagMatchingDescendants( *document, "*", DUBLIN_CORE_NS );
-
-    QList< Metadata::MetaElement > metadata;
-
-    foreach( xc::DOMElement *dc_element, dc_elements )
-    {
-        // Map the names in the OPF file to internal names
-        Metadata::MetaElement book_meta = Metadata::Instance().MapToBookMetadata( *dc_element );
-
-        if ( !book_meta.name.isEmpty() && !book_meta.value.toString().isEmpty() )
-        {
-            metadata.append( book_meta );
-        }
-    }
-
-    return metadata;
+    return GetPackageModel()->dc_metadata;
 }
 
 
@@ -449,7 +409,7 @@ QList< QVariant > OPFResource::GetDCMetadataValues( QString text ) const
 void OPFResource::SetDCMetadata( const QList< Metadata::MetaElement > &metadata )
 {
     QWriteLocker locker( &GetLock() );
-    shared_ptr< xc::DOMDocument > document = GetDocument();
+    shared_ptr< xc::DOMDocument > document = TakeDocument();
 
     RemoveDCElements( *document );
 
@@ -460,7 +420,7 @@ void OPFResource::SetDCMetadata( const QList< Metadata::MetaElement > &metadata
 
     SetMetaElementsLast( *document );
 
-    UpdateTextFromDom( *document );
+    CommitDocument( document );
 }
 
 
@@ -468,24 +428,47 @@ void OPFResource::AddResource( const Resource &resource )
 {
     QWriteLocker locker( &GetLock() );
 
-    shared_ptr< xc::DOMDocument > document = GetDocument();
+    shared_ptr< xc::DOMDocument > document = TakeDocument();
+    AddResourceToDocument( resource, *document );
+    CommitDocument( document );
+}
+
+
+void OPFResource::AddResources( const QList< Resource* > &resources )
+{
+    if ( resources.isEmpty() )
+
+        return;
+
+    QWriteLocker locker( &GetLock() );
+
+    shared_ptr< xc::DOMDocument > document = TakeDocument();
+
+    foreach( Resource *resource, resources )
+    {
+        AddResourceToDocument( *resource, *document );
+    }
+
+    CommitDocument( document );
+}
+
 
+void OPFResource::AddResourceToDocument( const Resource &resource, xc::DOMDocument &document )
+{
     QHash< QString, QString > attributes;
-    attributes[ "id"         ] = GetUniqueID( GetValidID( resource.Filename() ), *document );
+    attributes[ "id"         ] = GetUniqueID( GetValidID( resource.Filename() ), document );
     attributes[ "href"       ] = Utility::URLEncodePath( resource.GetRelativePathToOEBPS() );
     attributes[ "media-type" ] = GetResourceMimetype( resource );
 
     xc::DOMElement *new_item = XhtmlDoc::CreateElementInDocument( 
-        "item", OPF_XML_NAMESPACE, *document, attributes );
+        "item", OPF_XML_NAMESPACE, document, attributes );
 
-    xc::DOMElement &manifest = GetManifestElement( *document );
+    xc::DOMElement &manifest = GetManifestElement( document );
     manifest.appendChild( new_item );
 
     if ( resource.Type() == Resource::HTMLResourceType )
 
-        AppendToSpine( attributes[ "id" ], *document );
-
-    UpdateTextFromDom( *document );
+        AppendToSpine( attributes[ "id" ], document );
 }
 
 void OPFResource::RemoveCoverMetaForImage(const Resource &resource, xc::DOMDocument &document)
@@ -525,7 +508,7 @@ void OPFResource::RemoveResource( const Resource &resource )
 {
     QWriteLocker locker( &GetLock() );
 
-    shared_ptr< xc::DOMDocument > document  = GetDocument();
+    shared_ptr< xc::DOMDocument > document  = TakeDocument();
     xc::DOMElement &manifest                = GetManifestElement( *document );
     std::vector< xc::DOMElement* > children = xe::GetElementChildren( manifest );
     QString resource_oebps_path             = Utility::URLEncodePath( resource.GetRelativePathToOEBPS() );
@@ -554,7 +537,7 @@ void OPFResource::RemoveResource( const Resource &resource )
         RemoveGuideReferenceForResource( resource, *document );
     }
 
-    UpdateTextFromDom( *document );
+    CommitDocument( document );
 }
 
 
@@ -564,7 +547,7 @@ void OPFResource::AddGuideSemanticType(
 {
     QWriteLocker locker( &GetLock() );
 
-    shared_ptr< xc::DOMDocument > document         = GetDocument();
+    shared_ptr< xc::DOMDocument > document         = TakeDocument();
     GuideSemantics::GuideSemanticType current_type = GetGuideSemanticTypeForResource( html_resource, *document );
        
     if ( current_type != new_type )
@@ -580,7 +563,7 @@ void OPFResource::AddGuideSemanticType(
         RemoveGuideReferenceForResource( html_resource, *document );
     }
 
-    UpdateTextFromDom( *document );
+    CommitDocument( document );
 }
 
 
@@ -588,7 +571,7 @@ void OPFResource::SetResourceAsCoverImage( const ::ImageResource &image_resource
 {
     QWriteLocker locker( &GetLock() );
 
-    shared_ptr< xc::DOMDocument > document = GetDocument();
+    shared_ptr< xc::DOMDocument > document = TakeDocument();
 
     if (IsCoverImageCheck(image_resource, *document)) {
         RemoveCoverMetaForImage(image_resource, *document);
@@ -597,14 +580,14 @@ void OPFResource::SetResourceAsCoverImage( const ::ImageResource &image_resource
         AddCoverMetaForImage(image_resource, *document);
     }
 
-    UpdateTextFromDom( *document );
+    CommitDocument( document );
 }
 
 
 void OPFResource::UpdateSpineOrder( const QList< ::HTMLResource* > html_files )
 {
     QWriteLocker locker( &GetLock() );
-    shared_ptr< xc::DOMDocument > document = GetDocument();
+    shared_ptr< xc::DOMDocument > document = TakeDocument();
 
     QHash< ::HTMLResource*, xc::DOMElement* > itemref_mapping =
         GetItemrefsForHTMLResources( html_files, *document );
@@ -622,14 +605,14 @@ void OPFResource::UpdateSpineOrder( const QList< ::HTMLResource* > html_files )
             spine.appendChild( itemref );
     }
 
-    UpdateTextFromDom( *document );
+    CommitDocument( document );
 }
 
 
 void OPFResource::ResourceRenamed( const Resource& resource, QString old_full_path )
 {
     QWriteLocker locker( &GetLock() );
-    shared_ptr< xc::DOMDocument > document = GetDocument();
+    shared_ptr< xc::DOMDocument > document = TakeDocument();
 
     QString path_to_oebps_folder = QFileInfo( GetFullPath() ).absolutePath() + "/";
     QString resource_oebps_path  = Utility::URLEncodePath( QString( old_full_path ).remove( path_to_oebps_folder ) );
@@ -668,7 +651,7 @@ void OPFResource::ResourceRenamed( const Resource& resource, QString old_full_pa
         }
     }
 
-    UpdateTextFromDom( *document );
+    CommitDocument( document );
 }
 
 
@@ -721,14 +704,168 @@ void OPFResource::UpdateItemrefID( const QString &old_id, const QString &new_id,
 }
 
 
-shared_ptr< xc::DOMDocument > OPFResource::GetDocument() const
+shared_ptr< const OPFResource::PackageModel > OPFResource::GetPackageModel() const
+{
+    // Callers hold at least the read lock and the text is only changed under
+    // the write lock (TakeDocument()/CommitDocument() callers included), so
+    // the text can't change between reading the generation and the text.
+    // The mutex is there for concurrent readers, which would otherwise build
+    // and store the model at the same time. Reading the generation first is
+    // still the safe order: a change in between would leave a model that is
+    // newer than its generation says and gets rebuilt on the next call,
+    // never an old model that passes for the current one.
+    int generation = GetModificationGeneration();
+
+    QMutexLocker locker( &m_PackageModelMutex );
+
+    if ( m_PackageModel && m_PackageModel->generation == generation )
+
+        return m_PackageModel;
+
+    shared_ptr< xc::DOMDocument > document = GetDocument( GetText() );
+    shared_ptr< PackageModel > package     = BuildPackageModel( *document );
+    package->generation = generation;
+
+    m_PackageModel = package;
+    m_Document     = document;
+
+    return m_PackageModel;
+}
+
+
+shared_ptr< xc::DOMDocument > OPFResource::TakeDocument()
+{
+    int generation = GetModificationGeneration();
+
+    QMutexLocker locker( &m_PackageModelMutex );
+
+    shared_ptr< xc::DOMDocument > document;
+
+    if ( m_PackageModel && m_PackageModel->generation == generation )
+
+        document = m_Document;
+
+    // The caller is going to modify the DOM, so it can't stay
+    // in the cache until it's been written back to the text.
+    m_Document.reset();
+
+    if ( !document )
+
+        document = GetDocument( GetText() );
+
+    return document;
+}
+
+
+void OPFResource::CommitDocument( const shared_ptr< xc::DOMDocument > &document )
+{
+    UpdateTextFromDom( *document );
+
+    shared_ptr< PackageModel > package = BuildPackageModel( *document );
+    package->generation = GetModificationGeneration();
+
+    QMutexLocker locker( &m_PackageModelMutex );
+
+    m_PackageModel = package;
+    m_Document     = document;
+}
+
+
+shared_ptr< OPFResource::PackageModel > OPFResource::BuildPackageModel( const xc::DOMDocument &document )
+{
+    shared_ptr< PackageModel > package( new PackageModel() );
+
+    QList< xc::DOMElement* > items = 
+        XhtmlDoc::GetTagMatchingDescendants( document, "item", OPF_XML_NAMESPACE );
+
+    foreach( xc::DOMElement* item, items )
+    {
+        QString id   = XtoQ( item->getAttribute( QtoX( "id" ) ) );
+        QString href = XtoQ( item->getAttribute( QtoX( "href" ) ) );
+
+        package->id_to_href[ id ] = href;
+
+        if ( !package->href_to_id.contains( href ) )
+
+            package->href_to_id[ href ] = id;
+    }
+
+    QList< xc::DOMElement* > itemrefs = 
+        XhtmlDoc::GetTagMatchingDescendants( document, "itemref", OPF_XML_NAMESPACE );
+
+    for ( int i = 0; i < itemrefs.count(); ++i )
+    {
+        QString idref = XtoQ( itemrefs[ i ]->getAttribute( QtoX( "idref" ) ) );
+        package->spine.append( idref );
+
+        if ( !package->spine_positions.contains( idref ) )
+
+            package->spine_positions[ idref ] = i;
+    }
+
+    QList< xc::DOMElement* > references = 
+        XhtmlDoc::GetTagMatchingDescendants( document, "reference", OPF_XML_NAMESPACE );
+
+    foreach( xc::DOMElement* reference, references )
+    {
+        package->guide.append( qMakePair( XtoQ( reference->getAttribute( QtoX( "type" ) ) ),
+                                          XtoQ( reference->getAttribute( QtoX( "href" ) ) ) ) );
+    }
+
+    xc::DOMElement* cover_meta = GetCoverMeta( document );
+
+    if ( cover_meta )
+    {
+        package->has_cover_meta     = true;
+        package->cover_meta_content = XtoQ( cover_meta->getAttribute( QtoX( "content" ) ) );
+    }
+
+    xc::DOMElement* main_identifier = GetMainIdentifierUnsafe( document );
+
+    if ( main_identifier )
+
+        package->main_identifier = XtoQ( main_identifier->getTextContent() );
+
+    QList< xc::DOMElement* > identifiers = 
+        XhtmlDoc::GetTagMatchingDescendants( document, "identifier", DUBLIN_CORE_NS );
+
+    foreach( xc::DOMElement *identifier, identifiers )
+    {
+        QString value = XtoQ( identifier->getTextContent() ).remove( "urn:uuid:" );
+
+        if ( !QUuid( value ).isNull() )
+        {
+            package->uuid_identifier = value;
+            break;
+        }
+    }
+
+    QList< xc::DOMElement* > dc_elements = 
+        XhtmlDoc::GetTagMatchingDescendants( document, "*", DUBLIN_CORE_NS );
+
+    foreach( xc::DOMElement *dc_element, dc_elements )
+    {
+        // Map the names in the OPF file to internal names
+        Metadata::MetaElement book_meta = Metadata::Instance().MapToBookMetadata( *dc_element );
+
+        if ( !book_meta.name.isEmpty() && !book_meta.value.toString().isEmpty() )
+        {
+            package->dc_metadata.append( book_meta );
+        }
+    }
+
+    return package;
+}
+
+
+shared_ptr< xc::DOMDocument > OPFResource::GetDocument( const QString &source ) const
 {
     // The call to ProcessXML is needed because even though we have well-formed
     // checks tied to "focus lost" events of the OPF tab, on Win XP those events
     // are sometimes not delivered at all. Blame MS. In the mean time, this
     // work-around makes sure we get valid XML into Xerces no matter what.
     shared_ptr< xc::DOMDocument > document = 
-        XhtmlDoc::LoadTextIntoDocument( CleanSource::ProcessXML( GetText() ) );
+        XhtmlDoc::LoadTextIntoDocument( CleanSource::ProcessXML( source ) );
 
     if ( !BasicStructurePresent( *document ) )
 
@@ -1254,7 +1391,7 @@ void OPFResource::AddModificationDateMeta()
     QString date = QDate::currentDate().toString( "yyyy-MM-dd" );
 
     QWriteLocker locker( &GetLock() );
-    shared_ptr< xc::DOMDocument > document = GetDocument();
+    shared_ptr< xc::DOMDocument > document = TakeDocument();
 
     QList< xc::DOMElement* > metas =
         XhtmlDoc::GetTagMatchingDescendants( *document, "date", DUBLIN_CORE_NS );
@@ -1266,7 +1403,7 @@ void OPFResource::AddModificationDateMeta()
         if ( name == "modification" )
         {
             meta->setTextContent( QtoX( date ) );
-            UpdateTextFromDom( *document );
+            CommitDocument( document );
             return;
         }
     }
@@ -1278,7 +1415,7 @@ void OPFResource::AddModificationDateMeta()
     xc::DOMElement &metadata = GetMetadataElement( *document );
     metadata.appendChild( element );
 
-    UpdateTextFromDom( *document );
+    CommitDocument( document );
 }
 
 void OPFResource::WriteDate( 
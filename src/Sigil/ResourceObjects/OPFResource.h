@@ -25,6 +25,9 @@
 
 #include <boost/shared_ptr.hpp>
 
+#include <QtCore/QMutex>
+#include <QtCore/QPair>
+
 #include "BookManipulation/GuideSemantics.h"
 #include "ResourceObjects/XMLResource.h"
 #include "BookManipulation/Metadata.h"
@@ -61,6 +64,16 @@ public:
 
     int GetReadingOrder( const ::HTMLResource &html_resource ) const;
 
+    /**
+     * Returns the reading orders of all the provided HTML resources.
+     * The package model is only looked up once, so this is much
+     * cheaper than calling GetReadingOrder() for every resource.
+     *
+     * @param html_resources The resources whose reading orders we want.
+     * @return The reading order of each resource, -1 if it's not in the spine.
+     */
+    QHash< ::HTMLResource*, int > GetReadingOrders( const QList< ::HTMLResource* > &html_resources ) const;
+
     QString GetCoverPageOEBPSPath() const;
 
     QString GetMainIdentifierValue() const;
@@ -129,6 +142,14 @@ public slots:
 
     void AddResource( const Resource &resource );
 
+    /**
+     * Adds the manifest items (and spine entries for HTML files)
+     * of all the resources with one update of the OPF.
+     *
+     * @param resources The resources to add.
+     */
+    void AddResources( const QList< Resource* > &resources );
+
     void RemoveCoverMetaForImage(const Resource &resource, xc::DOMDocument &document);
 
     void AddCoverMetaForImage(const Resource &resource, xc::DOMDocument &document);
@@ -145,13 +166,107 @@ public slots:
 
 private:
 
+    /**
+     * An in-memory summary of the package document.
+     * Built once per OPF modification generation so the read-only
+     * accessors don't need to run the whole OPF through Tidy 
+     * and Xerces on every call.
+     */
+    struct PackageModel
+    {
+        /**
+         * The modification generation this model was built from.
+         */
+        int generation;
+
+        /**
+         * Manifest item IDs mapped to their (URL encoded) hrefs.
+         */
+        QHash< QString, QString > id_to_href;
+
+        /**
+         * Manifest item hrefs (URL encoded) mapped to their IDs.
+         * Only the first item with a given href is recorded.
+         */
+        QHash< QString, QString > href_to_id;
+
+        /**
+         * The itemref idrefs, in spine order.
+         */
+        QStringList spine;
+
+        /**
+         * Spine idrefs mapped to their first position in the spine.
+         */
+        QHash< QString, int > spine_positions;
+
+        /**
+         * The guide references as (type, href) pairs, in document order.
+         */
+        QList< QPair< QString, QString > > guide;
+
+        bool has_cover_meta;
+
+        QString cover_meta_content;
+
+        QString main_identifier;
+
+        /**
+         * The first identifier holding a valid UUID,
+         * without the "urn:uuid:" prefix.
+         */
+        QString uuid_identifier;
+
+        QList< Metadata::MetaElement > dc_metadata;
+
+        PackageModel() : generation( -1 ), has_cover_meta( false ) {}
+    };
+
+    /**
+     * Returns the package model for the current OPF text,
+     * (re)building it if the text has changed since the last call.
+     * Callers should hold (at least) a read lock.
+     *
+     * @return The package model.
+     */
+    shared_ptr< const PackageModel > GetPackageModel() const;
+
+    /**
+     * Returns the DOM for the current OPF text, for in-place modification.
+     * The cached DOM is handed out if it is still current; the caller
+     * takes ownership and must give it back with CommitDocument().
+     * Callers should hold a write lock.
+     *
+     * @return The OPF DOM document.
+     */
+    shared_ptr< xc::DOMDocument > TakeDocument();
+
+    /**
+     * Writes the modified DOM back to the resource text
+     * and updates the package model from it without a reparse.
+     *
+     * @param document The OPF DOM that was returned by TakeDocument().
+     */
+    void CommitDocument( const shared_ptr< xc::DOMDocument > &document );
+
+    static shared_ptr< PackageModel > BuildPackageModel( const xc::DOMDocument &document );
+
+    /**
+     * Adds the manifest item of the resource to the DOM, and
+     * appends it to the spine if it's an HTML file.
+     *
+     * @param resource The resource to add.
+     * @param document The OPF DOM that was returned by TakeDocument().
+     */
+    void AddResourceToDocument( const Resource &resource, xc::DOMDocument &document );
+
     static void AppendToSpine( const QString &id, xc::DOMDocument &document );
 
     static void RemoveFromSpine( const QString &id, xc::DOMDocument &document );
 
     static void UpdateItemrefID( const QString &old_id, const QString &new_id, xc::DOMDocument &document );
 
-    boost::shared_ptr< xc::DOMDocument > GetDocument() const;
+    boost::shared_ptr< xc::DOMDocument > GetDocument( const QString &source ) const;
 
     static xc::DOMElement& GetPackageElement( const xc::DOMDocument &document );
 
@@ -296,6 +411,22 @@ private:
      */
     QHash< QString, QString > m_Mimetypes;
 
+    /**
+     * The cached package model.
+     * @see GetPackageModel()
+     */
+    mutable shared_ptr< const PackageModel > m_PackageModel;
+
+    /**
+     * The DOM the cached package model was built from.
+     * Can be NULL if a writer took it and didn't give it back.
+     */
+    mutable shared_ptr< xc::DOMDocument > m_Document;
+
+    /**
+     * Guards access to m_PackageModel and m_Document.
+     */
+    mutable QMutex m_PackageModelMutex;
 };
 
 #endif // OPFRESOURCE_H
@@ -34,6 +34,8 @@ Resource::Resource( const QString &fullfilepath, QObject *parent )
     m_Identifier( Utility::CreateUUID() ),
     m_FullFilePath( fullfilepath ),
     m_LastSaved(0),
+    m_ModificationGeneration( 0 ),
+    m_SavedGeneration( 0 ),
     m_ReadWriteLock( QReadWriteLock::Recursive )
 {
 
@@ -94,6 +96,18 @@ QReadWriteLock& Resource::GetLock() const
 }
 
 
+int Resource::GetModificationGeneration() const
+{
+    return m_ModificationGeneration;
+}
+
+
+bool Resource::IsDirty() const
+{
+    return m_SavedGeneration != m_ModificationGeneration;
+}
+
+
 QIcon Resource::Icon() const
 {
     return QFileIconProvider().icon( QFileInfo( m_FullFilePath ) );
@@ -116,6 +130,7 @@ bool Resource::RenameTo( const QString &new_filename )
     {
         QString old_path = m_FullFilePath;
         m_FullFilePath = new_path;
+        BumpModificationGeneration();
         emit Renamed( *this, old_path );
     }
 
@@ -152,6 +167,19 @@ bool Resource::LoadFromDisk()
     return false;
 }
 
+
+void Resource::BumpModificationGeneration()
+{
+    m_ModificationGeneration.fetchAndAddOrdered( 1 );
+}
+
+
+void Resource::MarkSaved( int generation )
+{
+    m_SavedGeneration.fetchAndStoreOrdered( generation );
+}
+
+
 void Resource::SaveToDisk( bool book_wide_save )
 {
     const QDateTime lastModifiedDate = QFileInfo(m_FullFilePath).lastModified();
@@ -159,6 +187,8 @@ void Resource::SaveToDisk( bool book_wide_save )
     {
         m_LastSaved = lastModifiedDate.toMSecsSinceEpoch();
     }
+
+    MarkSaved( GetModificationGeneration() );
 }
 
 void Resource::FileChangedOnDisk()
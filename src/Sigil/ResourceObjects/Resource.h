@@ -23,6 +23,7 @@
 #ifndef RESOURCE_H
 #define RESOURCE_H
 
+#include <QtCore/QAtomicInt>
 #include <QtCore/QObject>
 #include <QtCore/QReadWriteLock>
 #include <QtCore/QUrl>
@@ -134,6 +135,23 @@ public:
      */
     QReadWriteLock& GetLock() const;
 
+    /**
+     * Returns the resource's modification generation. The number
+     * changes every time the resource's data changes, so it can be
+     * used as a cheap key for caches of data derived from the resource.
+     *
+     * @return The current modification generation.
+     */
+    int GetModificationGeneration() const;
+
+    /**
+     * Returns whether the resource data has changed since it
+     * was last saved to disk (or loaded from it).
+     *
+     * @return \c true if the data on disk is out of date.
+     */
+    bool IsDirty() const;
+
     /**
      * Returns the resource's icon.
      *
@@ -225,6 +243,21 @@ protected:
      */
     virtual bool LoadFromDisk();
 
+    /**
+     * Marks the resource data as changed by moving
+     * to the next modification generation.
+     * Must be called \em after the new data is in place.
+     */
+    void BumpModificationGeneration();
+
+    /**
+     * Records that the data of the given modification
+     * generation is now stored on disk.
+     *
+     * @param generation The generation that was saved.
+     */
+    void MarkSaved( int generation );
+
 private:
 
     /**
@@ -242,6 +275,18 @@ private:
      */
     qint64 m_LastSaved;
 
+    /**
+     * The current modification generation. 
+     * @see GetModificationGeneration()
+     */
+    QAtomicInt m_ModificationGeneration;
+
+    /**
+     * The modification generation last written to disk.
+     * @see IsDirty()
+     */
+    QAtomicInt m_SavedGeneration;
+
     /**
      * The ReaWriteLock guarding access to the resource's data.
      */
@@ -35,10 +35,12 @@ TextResource::TextResource( const QString &fullfilepath, QObject *parent )
     :
     Resource( fullfilepath, parent ),
     m_CacheInUse( false ),
+    m_SettingTextInternally( false ),
     m_TextDocument( new QTextDocument( this ) )
 {
     InitialLoad();
     m_TextDocument->setDocumentLayout( new QPlainTextDocumentLayout( m_TextDocument ) );
+    connect( m_TextDocument, SIGNAL( contentsChanged() ), this, SLOT( TextDocumentContentsChanged() ) );
     connect( m_TextDocument, SIGNAL( contentsChanged() ), this, SIGNAL( Modified() ) );
 }
 
@@ -85,6 +87,8 @@ void TextResource::SetText( const QString& text )
             QTimer::singleShot( 0, this, SLOT( DelayedUpdateToTextDocument() ) );
         }
     }
+
+    BumpModificationGeneration();
 }
 
 
@@ -103,6 +107,8 @@ void TextResource::SaveToDisk( bool book_wide_save )
     // when the user has not changed the text file.
     // (some text files have placeholder text on disk)
 
+    int generation = GetModificationGeneration();
+
     {
         QWriteLocker locker( &GetLock() );
 
@@ -115,6 +121,7 @@ void TextResource::SaveToDisk( bool book_wide_save )
 
     m_TextDocument->setModified( false );
     Resource::SaveToDisk( book_wide_save );
+    MarkSaved( generation );
 }
 
 
@@ -127,6 +134,9 @@ void TextResource::InitialLoad()
     if ( m_TextDocument->toPlainText().isEmpty() && QFile::exists( GetFullPath() ) )
     {
         SetText(Utility::ReadUnicodeTextFile(GetFullPath()));
+
+        // The text is what's on disk, so there's nothing to save
+        MarkSaved( GetModificationGeneration() );
     }
 }
 
@@ -153,6 +163,8 @@ bool TextResource::LoadFromDisk()
             QTimer::singleShot( 0, this, SLOT( DelayedUpdateToTextDocument() ) );
         }
 
+        BumpModificationGeneration();
+        MarkSaved( GetModificationGeneration() );
         return true;
     }
     catch (CannotOpenFile)
@@ -176,9 +188,21 @@ void TextResource::DelayedUpdateToTextDocument()
 }
 
 
+void TextResource::TextDocumentContentsChanged()
+{
+    // SetText() has already moved to a new generation
+    // for the text SetTextInternal() puts in the document.
+    if ( !m_SettingTextInternally )
+
+        BumpModificationGeneration();
+}
+
+
 void TextResource::SetTextInternal( const QString &text )
 {
+    m_SettingTextInternally = true;
     m_TextDocument->setPlainText( text );
+    m_SettingTextInternally = false;
     m_TextDocument->setModified( false );
 
     // Clear anything left in the cache
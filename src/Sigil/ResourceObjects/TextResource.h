@@ -94,6 +94,12 @@ private slots:
      */
     void DelayedUpdateToTextDocument();
 
+    /**
+     * Moves the resource to a new modification generation
+     * whenever the text in m_TextDocument changes.
+     */
+    void TextDocumentContentsChanged();
+
 private:
 
     /**
@@ -113,6 +119,12 @@ private:
      */
     bool m_CacheInUse;
 
+    /**
+     * If \c true, SetTextInternal() is putting text into m_TextDocument
+     * and the resulting change notifications should be ignored.
+     */
+    bool m_SettingTextInternally;
+
     /**
      * The cached text used when threads are in use. @see SetText() internals.
      */
@@ -133,7 +133,7 @@ void AnchorUpdates::UpdateAnchorsInOneFile( HTMLResource *html_resource,
             }
         }
     }
-    html_resource->SetText(XhtmlDoc::GetDomDocumentAsString(document));
+    html_resource->SetText(XhtmlDoc::GetDomDocumentAsString(document), HTMLResource::GetPathsToLinkedResources(document));
 }
 
 
@@ -182,7 +182,7 @@ void AnchorUpdates::UpdateExternalAnchorsInOneFile( HTMLResource *html_resource,
             }
         }
     }
-    html_resource->SetText(XhtmlDoc::GetDomDocumentAsString(document));
+    html_resource->SetText(XhtmlDoc::GetDomDocumentAsString(document), HTMLResource::GetPathsToLinkedResources(document));
 }
 
 void AnchorUpdates::UpdateTOCEntries(NCXResource *ncx_resource, const QString &originating_filename, const QList< HTMLResource* > new_files)
@@ -228,3 +228,254 @@ void AnchorUpdates::UpdateTOCEntries(NCXResource *ncx_resource, const QString &o
     ncx_resource->SetText(XhtmlDoc::GetDomDocumentAsString(document));
 }
 
+
+
+QHash< QString, QHash< QString, QString > > AnchorUpdates::GetIDLocationsAfterSplits( 
+    const QHash< QString, QList< HTMLResource* > > &new_files_by_originating_filename )
+{
+    QList< HTMLResource* > new_files;
+    QHash< QString, QString > originating_filenames;
+    QHash< QString, QHash< QString, QString > > ID_locations;
+
+    foreach( const QString &originating_filename, new_files_by_originating_filename.keys() )
+    {
+        foreach( HTMLResource *new_file, new_files_by_originating_filename.value( originating_filename ) )
+        {
+            new_files.append( new_file );
+            originating_filenames[ new_file->Filename() ] = originating_filename;
+        }
+
+        // Split files without any ids still need an entry.
+        ID_locations[ originating_filename ];
+    }
+
+    // The ids of all the new files are read in one parallel run.
+    const QList< tuple< QString, QList< QString > > > &IDs_in_files = QtConcurrent::blockingMapped( new_files, GetOneFileIDs );
+
+    for ( int i = 0; i < IDs_in_files.count(); ++i )
+    {
+        QList< QString > file_element_IDs;
+        QString resource_filename;
+
+        tie( resource_filename, file_element_IDs ) = IDs_in_files.at( i );
+
+        QHash< QString, QString > &locations = ID_locations[ originating_filenames.value( resource_filename ) ];
+
+        for ( int j = 0; j < file_element_IDs.count(); ++j )
+        {
+            locations[ file_element_IDs.at( j ) ] = resource_filename;
+        }
+    }
+
+    return ID_locations;
+}
+
+
+void AnchorUpdates::UpdateAnchorsAfterSplits( const QList< HTMLResource* > &html_resources, 
+                                              const QHash< QString, QList< HTMLResource* > > &new_files_by_originating_filename,
+                                              const QHash< QString, QHash< QString, QString > > &ID_locations )
+{
+    QHash< QString, QString > originating_filenames;
+
+    foreach( const QString &originating_filename, new_files_by_originating_filename.keys() )
+    {
+        foreach( HTMLResource *new_file, new_files_by_originating_filename.value( originating_filename ) )
+        {
+            originating_filenames[ new_file->Filename() ] = originating_filename;
+        }
+    }
+
+    const QList< tuple< QString, QStringList > > &updated_texts = QtConcurrent::blockingMapped( html_resources, 
+        boost::bind( UpdateAnchorsAfterSplitsInOneFile, _1, originating_filenames, ID_locations ) );
+
+    // The new texts are set here and not in the workers because
+    // setting them notifies the views, which live on this thread.
+    for ( int i = 0; i < html_resources.count(); ++i )
+    {
+        QString new_text;
+        QStringList linked_resource_paths;
+
+        tie( new_text, linked_resource_paths ) = updated_texts.at( i );
+
+        if ( new_text.isEmpty() )
+
+            continue;
+
+        HTMLResource *html_resource = html_resources.at( i );
+
+        QWriteLocker locker( &html_resource->GetLock() );
+
+        // The stored text isn't necessarily clean, so this
+        // goes through the cleaning setter.
+        html_resource->SetText( new_text, linked_resource_paths );
+    }
+}
+
+
+tuple< QString, QStringList > AnchorUpdates::UpdateAnchorsAfterSplitsInOneFile( 
+    HTMLResource *html_resource,
+    const QHash< QString, QString > originating_filenames,
+    const QHash< QString, QHash< QString, QString > > ID_locations )
+{
+    Q_ASSERT( html_resource );
+
+    QReadLocker locker( &html_resource->GetLock() );
+
+    const QString &resource_filename = html_resource->Filename();
+    const QString &source = html_resource->GetText();
+
+    // Empty unless the resource is one of the new files.
+    const QString &own_originating_filename = originating_filenames.value( resource_filename );
+
+    if ( own_originating_filename.isEmpty() )
+    {
+        // The other files only need to be parsed if they
+        // could have links to one of the split files.
+        bool links_to_split_file = false;
+
+        foreach( const QString &originating_filename, ID_locations.keys() )
+        {
+            if ( source.contains( originating_filename ) )
+            {
+                links_to_split_file = true;
+                break;
+            }
+        }
+
+        if ( !links_to_split_file )
+
+            return make_tuple( QString(), QStringList() );
+    }
+
+    shared_ptr<xc::DOMDocument> d = XhtmlDoc::LoadTextIntoDocument( source );
+    xc::DOMDocument &document = *d.get();
+    xc::DOMNodeList *anchors  = document.getElementsByTagName( QtoX( "a" ) );
+
+    QString text_folder_path = "../" % TEXT_FOLDER_NAME % "/";
+
+    bool updated = false;
+
+    for ( uint i = 0; i < anchors->getLength(); ++i )
+    {
+        xc::DOMElement &element = *static_cast< xc::DOMElement* >( anchors->item( i ) );
+
+        Q_ASSERT( &element );
+
+        if ( !element.hasAttribute( QtoX( "href" ) ) )
+
+            continue;
+
+        QString href = XtoQ( element.getAttribute( QtoX( "href" ) ) );
+        int fragment_index = href.indexOf( QChar( '#' ) );
+
+        if ( fragment_index == -1 || !QUrl( href ).isRelative() )
+
+            continue;
+
+        QString file_id     = href.left( fragment_index );
+        QString fragment_id = href.mid( fragment_index + 1 );
+
+        QString originating_filename;
+
+        // Links to another split file go to the new file with the id. In the new files
+        // the ids of their own split file are unique, so any link to one of them is updated.
+        if ( file_id.startsWith( text_folder_path ) && 
+             ID_locations.contains( file_id.mid( text_folder_path.length() ) ) )
+        {
+            originating_filename = file_id.mid( text_folder_path.length() );
+        }
+
+        else
+
+            originating_filename = own_originating_filename;
+
+        if ( originating_filename.isEmpty() )
+
+            continue;
+
+        const QString &new_filename = ID_locations.value( originating_filename ).value( fragment_id );
+
+        if ( new_filename.isEmpty() || new_filename == resource_filename )
+
+            continue;
+
+        QString attribute_value = QString( text_folder_path )
+                                  .append( Utility::URLEncodePath( new_filename ) )
+                                  .append( "#" )
+                                  .append( fragment_id );
+
+        element.setAttribute( QtoX( "href" ), QtoX( attribute_value ) );
+        updated = true;
+    }
+
+    if ( !updated )
+
+        return make_tuple( QString(), QStringList() );
+
+    return make_tuple( XhtmlDoc::GetDomDocumentAsString( document ), HTMLResource::GetPathsToLinkedResources( document ) );
+}
+
+
+void AnchorUpdates::UpdateTOCEntriesAfterSplits( NCXResource *ncx_resource, 
+                                                 const QHash< QString, QHash< QString, QString > > &ID_locations )
+{
+    Q_ASSERT( ncx_resource );
+
+    QWriteLocker locker( &ncx_resource->GetLock() );
+
+    shared_ptr<xc::DOMDocument> d = XhtmlDoc::LoadTextIntoDocument( ncx_resource->GetText() );
+    xc::DOMDocument &document = *d.get();
+    xc::DOMNodeList *anchors  = document.getElementsByTagName( QtoX( "content" ) );
+
+    QString text_folder_path = TEXT_FOLDER_NAME % "/";
+    bool updated = false;
+
+    for ( uint i = 0; i < anchors->getLength(); ++i )
+    {
+        xc::DOMElement &element = *static_cast< xc::DOMElement* >( anchors->item( i ) );
+
+        Q_ASSERT( &element );
+
+        if ( !element.hasAttribute( QtoX( "src" ) ) )
+
+            continue;
+
+        QString src = XtoQ( element.getAttribute( QtoX( "src" ) ) );
+        int fragment_index = src.indexOf( QChar( '#' ) );
+
+        if ( fragment_index == -1 || !QUrl( src ).isRelative() )
+
+            continue;
+
+        QString file_id     = src.left( fragment_index );
+        QString fragment_id = src.mid( fragment_index + 1 );
+
+        if ( !file_id.startsWith( text_folder_path ) )
+
+            continue;
+
+        const QString &new_filename = 
+            ID_locations.value( file_id.mid( text_folder_path.length() ) ).value( fragment_id );
+
+        if ( new_filename.isEmpty() )
+
+            continue;
+
+        QString attribute_value = QString( text_folder_path )
+                                  .append( Utility::URLEncodePath( new_filename ) )
+                                  .append( "#" )
+                                  .append( fragment_id );
+
+        if ( attribute_value == src )
+
+            continue;
+
+        element.setAttribute( QtoX( "src" ), QtoX( attribute_value ) );
+        updated = true;
+    }
+
+    // The NCX is only written out again if an entry changed
+    if ( updated )
+
+        ncx_resource->SetText( XhtmlDoc::GetDomDocumentAsString( document ) );
+}
@@ -54,6 +54,42 @@ public:
      */
     static void UpdateTOCEntries(NCXResource* ncx_resource, const QString &originating_filename, const QList< HTMLResource* > new_files);
 
+    /**
+     * Returns the locations of the ids in the files that several files were split into.
+     *
+     * @param new_files_by_originating_filename The new files created by splitting each file
+     *                                          (the split file included), keyed by the URL
+     *                                          encoded name of the split file.
+     * @return For each split file, the names of the new files that have the ids, keyed by id.
+     */
+    static QHash< QString, QHash< QString, QString > > GetIDLocationsAfterSplits(
+        const QHash< QString, QList< HTMLResource* > > &new_files_by_originating_filename );
+
+    /**
+     * Updates the anchors after several files were split at once, with one pass over html_resources.
+     * Anchors in the new files that point to ids of the file they were split from, and anchors 
+     * in any file that point to ids in another split file, are pointed to the new files with the ids.
+     * Only the files that need it are parsed.
+     *
+     * @param html_resources A list of xhtml files that need to be scanned, the new files included.
+     * @param new_files_by_originating_filename The new files created by splitting each file,
+     *                                          keyed by the URL encoded name of the split file.
+     * @param ID_locations The locations of the ids, as returned by GetIDLocationsAfterSplits().
+     */
+    static void UpdateAnchorsAfterSplits( const QList< HTMLResource* > &html_resources, 
+                                          const QHash< QString, QList< HTMLResource* > > &new_files_by_originating_filename,
+                                          const QHash< QString, QHash< QString, QString > > &ID_locations );
+
+    /**
+     * Updates the src attributes of the content tags in the toc.ncx file that point to
+     * ids in any of several split files, with one pass over the file.
+     *
+     * @param ncx_resource The TOC file
+     * @param ID_locations The locations of the ids, as returned by GetIDLocationsAfterSplits().
+     */
+    static void UpdateTOCEntriesAfterSplits( NCXResource* ncx_resource, 
+                                             const QHash< QString, QHash< QString, QString > > &ID_locations );
+
 private:
 
     static QHash< QString, QString > GetIDLocations( const QList< HTMLResource* > &html_resources );
@@ -64,6 +100,18 @@ private:
                                         const QHash< QString, QString > ID_locations );
 
     static void UpdateExternalAnchorsInOneFile( HTMLResource *html_resource, const QString &originating_filename, const QHash< QString, QString > id_locations );
+
+    /**
+     * Updates the anchors of one file after splits. The resource
+     * itself is not modified.
+     *
+     * @return The new text of the file and the paths to its linked
+     *         resources. The text is empty if nothing was updated.
+     */
+    static tuple< QString, QStringList > UpdateAnchorsAfterSplitsInOneFile( 
+        HTMLResource *html_resource,
+        const QHash< QString, QString > originating_filenames,
+        const QHash< QString, QHash< QString, QString > > ID_locations );
 };
 
 #endif // ANCHORUPDATES_H
@@ -88,5 +88,5 @@ void LinkUpdates::UpdateLinksInOneFile( HTMLResource *html_resource, QList<QStri
         head_element.appendChild( element );
     }
 
-    html_resource->SetText(XhtmlDoc::GetDomDocumentAsString(document));
+    html_resource->SetText(XhtmlDoc::GetDomDocumentAsString(document), HTMLResource::GetPathsToLinkedResources(document));
 }
@@ -20,65 +20,185 @@
 *************************************************************************/
 
 #include <QtCore/QFileInfo>
-#include <QtCore/QRegExp>
 #include <QtCore/QString>
+#include <QtCore/QStringList>
 
 #include "SourceUpdates/PerformCSSUpdates.h"
 
-PerformCSSUpdates::PerformCSSUpdates( const QString &source, const QHash< QString, QString > &css_updates )
+static const QString QUOTE_CHARS          = "\"'";
+static const QString REFERENCE_STOP_CHARS = ";}(\"'";
+static const QString URL_STOP_CHARS       = "()\"'";
+
+static const QStringList PROPERTY_NAMES = QStringList() << "src" << "background" << "background-image";
+
+PerformCSSUpdates::PerformCSSUpdates( const QString &source, 
+                                      const QHash< QString, QString > &css_updates,
+                                      bool is_declaration_list )
     : 
     m_Source( source ), 
-    m_CSSUpdates( css_updates )
+    m_CSSUpdates( css_updates ),
+    m_IsDeclarationList( is_declaration_list )
 {
 
 }
 
 
+// Replaces the URLs of src, background, background-image and @import
+// references whose filename matches that of an old path. This is done
+// in one pass over the source, regardless of the number of updates.
 QString PerformCSSUpdates::operator()()
 {
-    const QList< QString > &keys = m_CSSUpdates.keys();
-    int num_keys = keys.count();
+    if ( m_CSSUpdates.isEmpty() || !m_Source.contains( "url(" ) )
+
+        return m_Source;
+
+    const QHash< QString, QString > &updates = GetUpdatesByFilename();
+
+    // A reference needs to be terminated with a semicolon 
+    // or a closing brace to count.
+    int last_terminator = m_IsDeclarationList ? 
+                          m_Source.length() :
+                          qMax( m_Source.lastIndexOf( QChar( ';' ) ), m_Source.lastIndexOf( QChar( '}' ) ) );
 
-    for ( int i = 0; i < num_keys; ++i )
+    QString new_source;
+    new_source.reserve( m_Source.length() );
+
+    int copied_until = 0;
+    int source_length = m_Source.length();
+
+    for ( int i = 0; i < source_length; ++i )
     {
-        const QString &key_path = keys.at( i );
-        const QString &filename = QFileInfo( key_path ).fileName();
-
-        QString filename_regex_part = 
-            "[^\\(\\)\"']*/"
-            + QRegExp::escape( filename ) + "|"
-            + QRegExp::escape( filename );
-
-        QRegExp reference = QRegExp(
-            "(?:(?:src|background|background-image)\\s*:|@import)\\s*"
-            "[^;\\}\\(\"']*"
-            "(?:"
-                "url\\([\"']?(" + filename_regex_part + ")[\"']?\\)"
-                "|"
-                "[\"'](" + filename_regex_part + ")[\"']"
-            ")"
-            "[^;\\}]*"
-            "(?:;|\\})" );
-
-        int start_index = 0;
-
-        do
+        int reference_end = ReferenceStartEnd( i );
+
+        if ( reference_end == -1 )
+
+            continue;
+
+        int value_start = -1;
+        int value_end   = -1;
+
+        if ( !FindURLValue( reference_end, value_start, value_end ) ||
+             value_start < copied_until                             ||
+             last_terminator < value_end )
         {
-            m_Source.indexOf( reference, start_index );
+            continue;
+        }
+
+        const QString &url      = m_Source.mid( value_start, value_end - value_start );
+        const QString &filename = url.mid( url.lastIndexOf( QChar( '/' ) ) + 1 );
 
-            for ( int i = 1; i < reference.captureCount(); ++i )
-            {             
-                if ( reference.cap( i ).trimmed().isEmpty() )
+        if ( !updates.contains( filename ) )
 
-                    continue;
+            continue;
 
-                m_Source.replace( reference.pos( i ), reference.cap( i ).length(), m_CSSUpdates.value( key_path ) );
-            }
+        new_source.append( m_Source.midRef( copied_until, value_start - copied_until ) );
+        new_source.append( updates.value( filename ) );
+        copied_until = value_end;
+    }
+
+    if ( copied_until == 0 )
 
-            start_index += reference.matchedLength();
+        return m_Source;
+
+    new_source.append( m_Source.midRef( copied_until ) );
+    return new_source;
+}
+
+
+int PerformCSSUpdates::ReferenceStartEnd( int index ) const
+{
+    QChar first = m_Source.at( index );
+
+    if ( first == QChar( '@' ) )
+    {
+        return m_Source.midRef( index, 7 ) == QLatin1String( "@import" ) ? index + 7 : -1;
+    }
+
+    if ( first != QChar( 's' ) && first != QChar( 'b' ) )
+
+        return -1;
+
+    foreach( const QString &property_name, PROPERTY_NAMES )
+    {
+        if ( m_Source.midRef( index, property_name.length() ).compare( property_name ) != 0 )
+
+            continue;
+
+        int colon_index = index + property_name.length();
+
+        while ( colon_index < m_Source.length() && m_Source.at( colon_index ).isSpace() )
+        {
+            ++colon_index;
         }
-        while ( reference.matchedLength() != -1 );
+
+        if ( colon_index < m_Source.length() && m_Source.at( colon_index ) == QChar( ':' ) )
+
+            return colon_index + 1;
+    }
+
+    return -1;
+}
+
+
+bool PerformCSSUpdates::FindURLValue( int index, int &value_start, int &value_end ) const
+{
+    int source_length = m_Source.length();
+
+    // The value is the one in the first url() after the 
+    // reference start, and that has to come before any other 
+    // parenthesis, quote or end of the declaration.
+    int paren_index = index;
+
+    while ( paren_index < source_length && !REFERENCE_STOP_CHARS.contains( m_Source.at( paren_index ) ) )
+    {
+        ++paren_index;
+    }
+
+    if ( paren_index >= source_length                 || 
+         m_Source.at( paren_index ) != QChar( '(' )   ||
+         paren_index - 3 < index                      ||
+         m_Source.midRef( paren_index - 3, 3 ) != QLatin1String( "url" ) )
+    {
+        return false;
+    }
+
+    value_start = paren_index + 1;
+
+    if ( value_start < source_length && QUOTE_CHARS.contains( m_Source.at( value_start ) ) )
+
+        ++value_start;
+
+    value_end = value_start;
+
+    while ( value_end < source_length && !URL_STOP_CHARS.contains( m_Source.at( value_end ) ) )
+    {
+        ++value_end;
+    }
+
+    if ( value_end == value_start || value_end >= source_length )
+
+        return false;
+
+    // The URL can be followed by a (closing) quote,
+    // but there must be a closing parenthesis.
+    int closing_index = value_end;
+
+    if ( QUOTE_CHARS.contains( m_Source.at( closing_index ) ) )
+
+        ++closing_index;
+
+    return closing_index < source_length && m_Source.at( closing_index ) == QChar( ')' );
+}
+
+
+QHash< QString, QString > PerformCSSUpdates::GetUpdatesByFilename() const
+{
+    QHash< QString, QString > updates;
+
+    foreach( const QString &key_path, m_CSSUpdates.keys() )
+    {
+        updates[ QFileInfo( key_path ).fileName() ] = m_CSSUpdates.value( key_path );
     }
 
-    return m_Source;
+    return updates;
 }
@@ -27,17 +27,68 @@
 
 class QString;
 
+/**
+ * Performs path updates on CSS source (or any source
+ * with CSS in it, like XHTML files with <style> blocks).
+ */
 class PerformCSSUpdates
 {
 
 public:
 
-    PerformCSSUpdates( const QString &source, const QHash< QString, QString > &css_updates );
+    /**
+     * Constructor.
+     *
+     * @param source The raw text source to update.
+     * @param css_updates The path updates. The keys are the old
+     *                    paths (only the filename is looked at), and
+     *                    the values the new paths.
+     * @param is_declaration_list \c true if the source is just a list of
+     *                            declarations, like the value of a style
+     *                            attribute. The end of such source also
+     *                            ends the last declaration.
+     */
+    PerformCSSUpdates( const QString &source, 
+                       const QHash< QString, QString > &css_updates,
+                       bool is_declaration_list = false );
 
+    /**
+     * Performs the updates.
+     *
+     * @return The updated source.
+     */
     QString operator()( );
 
 private:
 
+    /**
+     * Returns the index just past the property name (and colon) of an
+     * src, background, background-image or @import reference
+     * that starts at the given index.
+     *
+     * @param index The index to look at.
+     * @return The index just past the reference start, or -1 if
+     *         no reference starts at the index.
+     */
+    int ReferenceStartEnd( int index ) const;
+
+    /**
+     * Finds the url() value that belongs to the reference starting
+     * at the given index. Only the first url() of a reference is 
+     * ever updated.
+     *
+     * @param index The index just past the reference start.
+     * @param value_start Set to the index of the first character of the URL.
+     * @param value_end Set to the index just past the last character of the URL.
+     * @return \c true if the reference has an updatable url() value.
+     */
+    bool FindURLValue( int index, int &value_start, int &value_end ) const;
+
+    /**
+     * Returns the updates keyed by just the filename of the old path.
+     */
+    QHash< QString, QString > GetUpdatesByFilename() const;
+
     ///////////////////////////////
     // PRIVATE MEMBER VARIABLES
     ///////////////////////////////
@@ -45,6 +96,8 @@ private:
     QString m_Source;
 
     const QHash< QString, QString > &m_CSSUpdates;
+
+    bool m_IsDeclarationList;
 };
 
 #endif // PERFORMCSSUPDATES_H
@@ -21,6 +21,7 @@
 
 #include "BookManipulation/XercesCppUse.h"
 #include "BookManipulation/XhtmlDoc.h"
+#include "sigil_exception.h"
 #include "SourceUpdates/PerformCSSUpdates.h"
 #include "SourceUpdates/PerformHTMLUpdates.h"
 
@@ -49,12 +50,37 @@ PerformHTMLUpdates::PerformHTMLUpdates( const xc::DOMDocument &document,
 
 shared_ptr< xc::DOMDocument > PerformHTMLUpdates::operator()()
 {
-    UpdateXMLReferences();
+    xc::DOMElement* document_element = m_Document->getDocumentElement();
 
-    if ( !m_CSSUpdates.isEmpty() )
+    if ( !document_element )
+    
+        boost_throw( ErrorBuildingDOM() );    
+
+    // The CSS is updated in place, so the document
+    // doesn't need to be serialized and parsed again.
+    QList< xc::DOMElement* > elements = XhtmlDoc::GetTagMatchingDescendants( *document_element, "*" );
+    elements.prepend( document_element );
+
+    int element_count = elements.count();
+
+    for ( int i = 0; i < element_count; ++i )
     {
-        m_Document = XhtmlDoc::LoadTextIntoDocument( 
-            PerformCSSUpdates( XhtmlDoc::GetDomDocumentAsString( *m_Document ), m_CSSUpdates )() );
+        xc::DOMElement &element = *elements.at( i );
+        const QString &name = XhtmlDoc::GetNodeName( element );
+
+        if ( m_PathTags.contains( name, Qt::CaseInsensitive ) )
+
+            UpdateReferenceInNode( &element );
+
+        if ( m_CSSUpdates.isEmpty() )
+
+            continue;
+
+        UpdateStyleAttribute( element );
+
+        if ( name.compare( "style", Qt::CaseInsensitive ) == 0 )
+
+            UpdateStyleElement( element );
     }
 
     return m_Document;
@@ -68,3 +94,46 @@ void PerformHTMLUpdates::InitPathTags()
     // that need to be updated.
     m_PathTags = QStringList() << "link" << "a" << "img" << "image" << "script";
 }
+
+
+void PerformHTMLUpdates::UpdateStyleAttribute( xc::DOMElement &element )
+{
+    if ( !element.hasAttribute( QtoX( "style" ) ) )
+
+        return;
+
+    const QString &style = XtoQ( element.getAttribute( QtoX( "style" ) ) );
+    const QString &new_style = PerformCSSUpdates( style, m_CSSUpdates, true )();
+
+    if ( new_style != style )
+
+        element.setAttribute( QtoX( "style" ), QtoX( new_style ) );
+}
+
+
+void PerformHTMLUpdates::UpdateStyleElement( xc::DOMElement &element )
+{
+    QList< xc::DOMNode* > children = XhtmlDoc::GetNodeChildren( element );
+
+    // The CSS can be in plain text, in CDATA sections or
+    // in comments (to hide it from old browsers), so each
+    // one is updated as is to keep the markup around the CSS.
+    foreach( xc::DOMNode *child, children )
+    {
+        if ( child->getNodeType() != xc::DOMNode::TEXT_NODE &&
+             child->getNodeType() != xc::DOMNode::CDATA_SECTION_NODE &&
+             child->getNodeType() != xc::DOMNode::COMMENT_NODE )
+        {
+            continue;
+        }
+
+        xc::DOMCharacterData &text = *static_cast< xc::DOMCharacterData* >( child );
+
+        const QString &css = XtoQ( text.getData() );
+        const QString &new_css = PerformCSSUpdates( css, m_CSSUpdates )();
+
+        if ( new_css != css )
+
+            text.setData( QtoX( new_css ) );
+    }
+}
@@ -38,12 +38,34 @@ public:
                         const QHash< QString, QString > &html_updates,
                         const QHash< QString, QString > &css_updates );
 
+    /**
+     * Performs the updates. The paths in the attributes, the inline
+     * styles and the <style> blocks are all updated in one walk over
+     * the elements of the document.
+     *
+     * @return The updated DOM of the provided XHTML file.
+     */
     shared_ptr< xc::DOMDocument > operator()();
 
 private:
 
     void InitPathTags();
 
+    /**
+     * Updates the paths in the CSS of the style attribute 
+     * of the element, if it has one.
+     *
+     * @param element The element to update.
+     */
+    void UpdateStyleAttribute( xc::DOMElement &element );
+
+    /**
+     * Updates the paths in the CSS of a <style> element.
+     *
+     * @param element The <style> element.
+     */
+    void UpdateStyleElement( xc::DOMElement &element );
+
 
     ///////////////////////////////
     // PRIVATE MEMBER VARIABLES
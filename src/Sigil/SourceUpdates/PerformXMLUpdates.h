@@ -75,6 +75,12 @@ protected:
      */
     void UpdateXMLReferences();
 
+    /**
+     * Updates the resource references in the attributes 
+     * of the one specified node in the XML.
+     */
+    void UpdateReferenceInNode( xc::DOMElement *node );
+
     /**
      * Holds all the tags with paths that should be looked at during
      * path updates.
@@ -97,12 +103,6 @@ protected:
 
 private:
 
-    /**
-     * Updates the resource references in the attributes 
-     * of the one specified node in the XML.
-     */
-    void UpdateReferenceInNode( xc::DOMElement *node );
-
     /**
      * Initializes the m_PathAttributes variable.
      */
@@ -164,9 +164,10 @@ void UniversalUpdates::UpdateOneHTMLFile( HTMLResource* html_resource,
     }
 
     QWriteLocker locker(&html_resource->GetLock());
-    shared_ptr<xc::DOMDocument> d = XhtmlDoc::LoadTextIntoDocument(html_resource->GetText());
-    shared_ptr<xc::DOMDocument> u = PerformHTMLUpdates(*d.get(), html_updates, css_updates)();
-    html_resource->SetText(XhtmlDoc::GetDomDocumentAsString(*u.get()));
+    shared_ptr<xc::DOMDocument> u = PerformHTMLUpdates(html_resource->GetText(), html_updates, css_updates)();
+    // The stored text isn't necessarily clean (Code View edits
+    // are stored as typed), so this goes through the cleaning setter.
+    html_resource->SetText(XhtmlDoc::GetDomDocumentAsString(*u.get()), HTMLResource::GetPathsToLinkedResources(*u.get()));
 }
 
 
@@ -197,9 +198,9 @@ void UniversalUpdates::LoadAndUpdateOneHTMLFile( HTMLResource* html_resource,
             XhtmlDoc::ResolveCustomEntities( 
                 HTMLEncodingResolver::ReadHTMLFile( html_resource->GetFullPath() ) ) );
 
-    //html_resource->SetDomDocument( PerformHTMLUpdates( source, html_updates, css_updates )() );
-
-    html_resource->SetText( XhtmlDoc::GetDomDocumentAsString(*PerformHTMLUpdates( source, html_updates, css_updates )().get() ) );
+    shared_ptr< xc::DOMDocument > document = PerformHTMLUpdates( source, html_updates, css_updates )();
+    html_resource->SetUpdatedText( XhtmlDoc::GetDomDocumentAsString( *document.get() ),
+                                   HTMLResource::GetPathsToLinkedResources( *document.get() ) );
 }
 
 
@@ -257,7 +257,7 @@ int BookViewPreview::Count(const QString &search_regex )
 {
     // Spell check not actually used
     SPCRE *spcre = PCRECache::instance()->getObject( search_regex );
-    return spcre->getEveryMatchInfo( GetSearchTools().fulltext ).count();
+    return spcre->countMatches( GetSearchTools().fulltext );
 }
 
 bool BookViewPreview::ReplaceSelected(const QString &search_regex, const QString &replacement, Searchable::Direction direction )
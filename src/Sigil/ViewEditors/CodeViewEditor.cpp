@@ -68,6 +68,30 @@ static const QString ATTRIB_VALUES_SEARCH   = "\"([^\"]*)";
 static const int MAX_SPELLING_SUGGESTIONS = 10;
 
 
+// Appends the offsets of every match, and of its
+// capture groups, to one flat vector.
+struct MatchOffsetsVisitor : public SPCRE::MatchVisitor
+{
+    MatchOffsetsVisitor( QVector< int > &ovectors, int &capture_count )
+        : m_Ovectors( ovectors ), m_CaptureCount( capture_count ) {}
+
+    bool visitMatch( const int *ovector, int capture_count )
+    {
+        m_CaptureCount = capture_count;
+
+        for ( int i = 0; i < ( 1 + capture_count ) * 2; ++i )
+        {
+            m_Ovectors.append( ovector[ i ] );
+        }
+
+        return true;
+    }
+
+    QVector< int > &m_Ovectors;
+    int &m_CaptureCount;
+};
+
+
 CodeViewEditor::CodeViewEditor( HighlighterType high_type, bool check_spelling, QWidget *parent )
     :
     QPlainTextEdit( parent ),
@@ -91,7 +115,8 @@ CodeViewEditor::CodeViewEditor( HighlighterType high_type, bool check_spelling,
     m_pendingGoToLinkOrStyleRequest( false ),
     m_pendingReformatCSSRequest( false ),
     m_reformatCSSMultiLine( false ),
-    m_pendingSpellingHighlighting( false)
+    m_pendingSpellingHighlighting( false),
+    m_SearchTextDocument( NULL )
 {
     if ( high_type == CodeViewEditor::Highlight_XHTML ) {
         m_Highlighter = new XHTMLHighlighter( check_spelling, this );
@@ -681,6 +706,7 @@ bool CodeViewEditor::FindNext( const QString &search_regex,
     SPCRE *spcre = PCRECache::instance()->getObject(search_regex);
 
     int selection_offset = GetSelectionOffset( search_direction, ignore_selection_offset );
+    const QString text = GetSearchText();
     SPCRE::MatchInfo match_info;
     int start_offset = 0;
 
@@ -688,22 +714,22 @@ bool CodeViewEditor::FindNext( const QString &search_regex,
     {
         if ( misspelled_words )
         {
-            match_info = GetMisspelledWord( toPlainText(), 0, selection_offset, search_regex, search_direction );
+            match_info = GetMisspelledWord( text, 0, selection_offset, search_regex, search_direction );
         }
         else
         {
-            match_info = spcre->getLastMatchInfo(Utility::Substring(0, selection_offset, toPlainText()));
+            match_info = GetPreviousMatchInfo( *spcre, selection_offset );
         }
     }
     else
     {
         if ( misspelled_words )
         {
-            match_info = GetMisspelledWord( toPlainText(), selection_offset, toPlainText().count(), search_regex, search_direction );
+            match_info = GetMisspelledWord( text, selection_offset, text.count(), search_regex, search_direction );
         }
         else
         {
-            match_info = spcre->getFirstMatchInfo( Utility::Substring(selection_offset, toPlainText().count(), toPlainText() ));
+            match_info = spcre->getFirstMatchInfo( text.constData() + selection_offset, text.count() - selection_offset );
         }
         start_offset = selection_offset;
     }
@@ -760,10 +786,77 @@ bool CodeViewEditor::FindNext( const QString &search_regex,
 }
 
 
+SPCRE::MatchInfo CodeViewEditor::GetPreviousMatchInfo( SPCRE &spcre, int offset )
+{
+    if ( m_PreviousMatchIndex.pattern  != spcre.getPattern() ||
+         m_PreviousMatchIndex.document != document()         ||
+         m_PreviousMatchIndex.revision != document()->revision() )
+    {
+        m_PreviousMatchIndex.pattern  = spcre.getPattern();
+        m_PreviousMatchIndex.document = document();
+        m_PreviousMatchIndex.revision = document()->revision();
+
+        const QString text = GetSearchText();
+        m_PreviousMatchIndex.ovectors.clear();
+        MatchOffsetsVisitor visitor( m_PreviousMatchIndex.ovectors, m_PreviousMatchIndex.capture_count );
+        spcre.forEachMatch( text.constData(), text.length(), visitor );
+    }
+
+    const QVector< int > &ovectors = m_PreviousMatchIndex.ovectors;
+    int stride = ( 1 + m_PreviousMatchIndex.capture_count ) * 2;
+
+    // The matches don't overlap, so their end offsets are
+    // sorted too. We look for the first match that ends after
+    // the offset; the one before it is the one we want.
+    int low  = 0;
+    int high = ovectors.count() / stride;
+
+    while ( low < high )
+    {
+        int middle = ( low + high ) / 2;
+
+        if ( ovectors.at( middle * stride + 1 ) <= offset )
+
+            low = middle + 1;
+
+        else
+
+            high = middle;
+    }
+
+    if ( low == 0 )
+
+        return SPCRE::MatchInfo();
+
+    return SPCRE::generateMatchInfo( ovectors.constData() + ( low - 1 ) * stride, m_PreviousMatchIndex.capture_count );
+}
+
+
 int CodeViewEditor::Count( const QString &search_regex )
 {
     SPCRE *spcre = PCRECache::instance()->getObject( search_regex );
-    return spcre->getEveryMatchInfo( toPlainText() ).count();
+    return spcre->countMatches( GetSearchText() );
+}
+
+
+QString CodeViewEditor::GetSearchText()
+{
+    if ( m_SearchTextDocument != document() )
+    {
+        m_SearchText         = toPlainText();
+        m_SearchTextDocument = document();
+
+        connect( document(), SIGNAL( contentsChange( int, int, int ) ), this, SLOT( ResetSearchText() ), Qt::UniqueConnection );
+    }
+
+    return m_SearchText;
+}
+
+
+void CodeViewEditor::ResetSearchText()
+{
+    m_SearchText.clear();
+    m_SearchTextDocument = NULL;
 }
 
 
@@ -774,7 +867,7 @@ bool CodeViewEditor::ReplaceSelected( const QString &search_regex, const QString
     // Convert to plain text or \s won't get newlines
     int selection_start = textCursor().selectionStart();
     int selection_end = textCursor().selectionEnd();
-    QString selected_text = Utility::Substring(selection_start, selection_end, toPlainText() );
+    QString selected_text = Utility::Substring(selection_start, selection_end, GetSearchText() );
 
     SPCRE::MatchInfo match_info;
 
@@ -832,24 +925,14 @@ bool CodeViewEditor::ReplaceSelected( const QString &search_regex, const QString
 int CodeViewEditor::ReplaceAll( const QString &search_regex, 
                                 const QString &replacement )
 {
-    int count = 0;
-
-    QString text = toPlainText();
+    QString text;
     SPCRE *spcre = PCRECache::instance()->getObject(search_regex);
-    QList<SPCRE::MatchInfo> match_info = spcre->getEveryMatchInfo(text);
+    int count = spcre->replaceAll(GetSearchText(), replacement, text);
 
-    // Run though all match offsets making the replacment in reverse order.
-    // This way changes in text lengh won't change the offsets as we make
-    // our changes.
-    for (int i = match_info.count() - 1; i >= 0; i--) {
-        QString replaced_text;
-        bool replacement_made = spcre->replaceText(Utility::Substring(match_info.at(i).offset.first, match_info.at(i).offset.second, text), match_info.at(i).capture_groups_offsets, replacement, replaced_text);
-
-        if (replacement_made) {
-            // Replace the text.
-            text = text.replace(match_info.at(i).offset.first, match_info.at(i).offset.second - match_info.at(i).offset.first, replaced_text);
-            count++;
-        }
+    // Nothing to replace, so we don't touch the document
+    // (and don't leave an empty step on the undo stack).
+    if (count == 0) {
+        return 0;
     }
 
     QTextCursor cursor = textCursor();
@@ -1679,7 +1762,9 @@ int CodeViewEditor::GetSelectionOffset( Searchable::Direction search_direction,
     }
     else
     {
-        return !ignore_selection_offset ? textCursor().selectionStart() : toPlainText().count() - 1;
+        // The character count includes the final paragraph
+        // separator, which isn't part of the plain text.
+        return !ignore_selection_offset ? textCursor().selectionStart() : document()->characterCount() - 2;
     }
 }
 
@@ -1795,7 +1880,7 @@ QList< ViewEditor::ElementIndex > CodeViewEditor::ConvertStackToHierarchy( const
 
 tuple< int, int > CodeViewEditor::ConvertHierarchyToCaretMove( const QList< ViewEditor::ElementIndex > &hierarchy ) const
 {
-    shared_ptr< xc::DOMDocument > dom = XhtmlDoc::LoadTextIntoDocument( toPlainText() );
+    shared_ptr< xc::DOMDocument > dom = XhtmlDoc::LoadTextIntoDocument( toPlainText(), true );
 
     xc::DOMNode *end_node = XhtmlDoc::GetNodeFromHierarchy( *dom, hierarchy );
     QTextCursor cursor( document() );
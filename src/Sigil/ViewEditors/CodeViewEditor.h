@@ -30,6 +30,7 @@
 #include <QtGui/QPlainTextEdit>
 #include <QtGui/QStandardItem>
 #include <QtCore/QUrl>
+#include <QtCore/QVector>
 
 #include "ViewEditors/ViewEditor.h"
 #include "Misc/CSSInfo.h"
@@ -410,6 +411,14 @@ protected:
     void focusOutEvent( QFocusEvent *event );
 
 private slots:
+    /**
+     * Drops the search text snapshot.
+     * Called whenever the contents of the document change.
+     *
+     * @see GetSearchText()
+     */
+    void ResetSearchText();
+
     /**
      * Filters the textChanged signal.
      * It does this based on the availability of undo.
@@ -637,6 +646,53 @@ private:
 
     QString GetUnmatchedTagsForBlock(const int &pos, const QString &text);
 
+    /**
+     * Every match of a pattern in the document, as of one
+     * document revision. Lets repeated Find Previous calls find
+     * the previous match without searching the document again.
+     */
+    struct MatchIndex
+    {
+        MatchIndex() : document( NULL ), revision( -1 ), capture_count( 0 ) {}
+
+        QString pattern;
+
+        /**
+         * The document and the revision of it
+         * that the matches were found in.
+         */
+        const QTextDocument *document;
+        int revision;
+
+        /**
+         * The offsets of the matches and their capture groups, in
+         * document order. Each match takes ( 1 + capture_count ) * 2
+         * ints, laid out as the ovector of a SPCRE::MatchVisitor.
+         */
+        QVector< int > ovectors;
+        int capture_count;
+    };
+
+    /**
+     * Returns the last match that ends at or before the offset.
+     * Uses (and if the document or the pattern changed, rebuilds)
+     * the match index, so the lookup itself is a binary search.
+     *
+     * @param spcre The search pattern.
+     * @param offset The offset in the document the match has to end before.
+     * @return The match, with offsets relative to the document.
+     */
+    SPCRE::MatchInfo GetPreviousMatchInfo( SPCRE &spcre, int offset );
+
+    /**
+     * Returns the text of the document for searching. The text is
+     * copied out of the document once and kept until the document
+     * changes, so consecutive searches don't copy it again.
+     *
+     * @return The text of the document.
+     */
+    QString GetSearchText();
+
     ///////////////////////////////
     // PRIVATE MEMBER VARIABLES
     ///////////////////////////////
@@ -728,6 +784,21 @@ private:
      */
     SPCRE::MatchInfo m_lastMatch;
 
+    /**
+     * The matches of the last pattern used for searching up.
+     * @see GetPreviousMatchInfo()
+     */
+    MatchIndex m_PreviousMatchIndex;
+
+    /**
+     * The snapshot of the document's text used for searching,
+     * and the document it was taken from. The document is
+     * NULL when there is no snapshot.
+     * @see GetSearchText()
+     */
+    QString m_SearchText;
+    const QTextDocument *m_SearchTextDocument;
+
     /**
      * Map spelling suggestion actions from the context menu to the
      * ReplaceSelected slot.
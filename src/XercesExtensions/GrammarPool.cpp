@@ -0,0 +1,74 @@
+/************************************************************************
+**
+**  Copyright (C) 2012  FlightCrew Developers
+**
+**  This file is part of FlightCrew.
+**
+**  FlightCrew is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU Lesser General Public License as published
+**  by the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  FlightCrew is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU Lesser General Public License for more details.
+**
+**  You should have received a copy of the GNU Lesser General Public License
+**  along with FlightCrew.  If not, see <http://www.gnu.org/licenses/>.
+**
+*************************************************************************/
+
+
+#include <boost/foreach.hpp>
+#include <xercesc/framework/XMLGrammarPoolImpl.hpp>
+#include <xercesc/parsers/XercesDOMParser.hpp>
+#include "GrammarPool.h"
+
+#define foreach BOOST_FOREACH
+
+namespace XercesExt
+{
+
+GrammarPool::GrammarPool( const std::vector< const xc::InputSource* > &dtds,
+                          const std::vector< const xc::InputSource* > &schemas )
+    :
+    m_Pool( new xc::XMLGrammarPoolImpl( xc::XMLPlatformUtils::fgMemoryManager ) )
+{
+    {
+        // The loading parser is only needed to compile the grammars;
+        // once loaded they are owned by the pool.
+        xc::XercesDOMParser loader( 0, xc::XMLPlatformUtils::fgMemoryManager, m_Pool.get() );
+
+        loader.setDoNamespaces(         true  );
+        loader.setDoSchema(             true  );
+        loader.setLoadSchema(           false );
+        loader.useCachedGrammarInParse( true  );
+
+        foreach( const xc::InputSource *input, dtds )
+        {
+            loader.loadGrammar( *input, xc::Grammar::DTDGrammarType, true );
+        }
+
+        foreach( const xc::InputSource *input, schemas )
+        {
+            loader.loadGrammar( *input, xc::Grammar::SchemaGrammarType, true );
+        }
+    }
+
+    m_Pool->lockPool();
+}
+
+
+GrammarPool::~GrammarPool()
+{
+    
+}
+
+
+xc::XMLGrammarPool& GrammarPool::GetPool()
+{
+    return *m_Pool;
+}
+
+} // namespace XercesExt
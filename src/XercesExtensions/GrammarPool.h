@@ -0,0 +1,79 @@
+/************************************************************************
+**
+**  Copyright (C) 2012  FlightCrew Developers
+**
+**  This file is part of FlightCrew.
+**
+**  FlightCrew is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU Lesser General Public License as published
+**  by the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  FlightCrew is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU Lesser General Public License for more details.
+**
+**  You should have received a copy of the GNU Lesser General Public License
+**  along with FlightCrew.  If not, see <http://www.gnu.org/licenses/>.
+**
+*************************************************************************/
+
+
+#pragma once
+#ifndef GRAMMARPOOL_H
+#define GRAMMARPOOL_H
+
+#include <vector>
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <xercesc/framework/XMLGrammarPool.hpp>
+#include <xercesc/sax/InputSource.hpp>
+
+namespace XERCES_CPP_NAMESPACE { class XMLGrammarPoolImpl; };
+namespace xc = XERCES_CPP_NAMESPACE;
+
+namespace XercesExt
+{
+
+/**
+ * A grammar pool that is filled with a fixed set of DTDs 
+ * and schemas once and then locked. A locked pool is read-only, 
+ * so the compiled grammars can be shared by any number of 
+ * parsers on any number of threads.
+ */
+class GrammarPool : private boost::noncopyable
+{
+public:
+
+    /**
+     * Constructor. Compiles all the given grammars into the pool.
+     *
+     * @param dtds The DTDs to load.
+     * @param schemas The XML schemas to load. Schemas that import 
+     *                other schemas need to come after them.
+     */
+    GrammarPool( const std::vector< const xc::InputSource* > &dtds,
+                 const std::vector< const xc::InputSource* > &schemas );
+
+    /**
+     * Destructor.
+     */
+    ~GrammarPool();
+
+    /**
+     * Returns the locked Xerces grammar pool. Parsers 
+     * using it need to have cached grammar use turned on.
+     *
+     * @return The grammar pool.
+     */
+    xc::XMLGrammarPool& GetPool();
+
+private:
+
+    boost::scoped_ptr< xc::XMLGrammarPoolImpl > m_Pool;
+};
+
+} // namespace XercesExt
+
+#endif // GRAMMARPOOL_H
@@ -20,9 +20,10 @@
 *************************************************************************/
 
 #include <xercesc/internal/XMLScanner.hpp>
-#include <xercesc/dom/DOMNamedNodeMap.hpp>
+#include <xercesc/dom/DOMDocument.hpp>
 #include "LocationAwareDOMParser.h"
 #include "LocationInfoDataHandler.h"
+#include "NodeLocationTable.h"
 
 // This can't be a member variable of the parser since it needs to be around
 // even after the parser is destroyed. The cleanup methods of the parser's
@@ -31,7 +32,6 @@
 // also easily go into a singleton, but this approach is simpler.
 static const XercesExt::LocationInfoDataHandler LOCATION_DATA_HANDLER;
 const char *LOCATION_INFO_KEY = "LocationInfoKey";
-typedef unsigned int uint; 
 
 namespace XercesExt
 {
@@ -40,7 +40,9 @@ LocationAwareDOMParser::LocationAwareDOMParser( xc::XMLValidator   *const valToA
                                                 xc::MemoryManager  *const manager,
                                                 xc::XMLGrammarPool *const gramPool )
     :
-    xc::XercesDOMParser( valToAdopt, manager, gramPool )
+    xc::XercesDOMParser( valToAdopt, manager, gramPool ),
+    m_TrackLocations( true ),
+    m_LocationTable( NULL )
 {
     m_LocationInfoKey = xc::XMLString::transcode( LOCATION_INFO_KEY );
 }
@@ -52,6 +54,51 @@ LocationAwareDOMParser::~LocationAwareDOMParser()
 }
 
 
+void LocationAwareDOMParser::setTrackLocations( bool track_locations )
+{
+    m_TrackLocations = track_locations;
+}
+
+
+bool LocationAwareDOMParser::getTrackLocations() const
+{
+    return m_TrackLocations;
+}
+
+
+void LocationAwareDOMParser::startDocument()
+{
+    xc::XercesDOMParser::startDocument();
+
+    m_LocationTable = NULL;
+
+    if ( !m_TrackLocations )
+
+        return;
+
+    // The document takes ownership of the table; the handler
+    // deletes it when the document is released.
+    m_LocationTable = new NodeLocationTable();
+
+    getDocument()->setUserData( 
+        m_LocationInfoKey,
+        m_LocationTable,
+        const_cast< XercesExt::LocationInfoDataHandler* >( &LOCATION_DATA_HANDLER ) );
+}
+
+
+void LocationAwareDOMParser::endDocument()
+{
+    xc::XercesDOMParser::endDocument();
+
+    if ( m_LocationTable )
+
+        m_LocationTable->Finalize();
+
+    m_LocationTable = NULL;
+}
+
+
 void LocationAwareDOMParser::startElement( const xc::XMLElementDecl &elemDecl,
                                            const unsigned int uriId,
                                            const XMLCh *const prefixName,
@@ -63,35 +110,18 @@ void LocationAwareDOMParser::startElement( const xc::XMLElementDecl &elemDecl,
     xc::XercesDOMParser::startElement(
             elemDecl, uriId, prefixName, attrList, attrCount, isEmpty, isRoot );
 
-    const xc::Locator* locator = getScanner()->getLocator();
-    int line_number   = (int) locator->getLineNumber();
-    int column_number = (int) locator->getColumnNumber();
-
-    xc::DOMNode *current_node = getCurrentNode();
-
-    // It's OK to const_cast the handler since the parser will only ever
-    // call the handler's handle() method, which doesn't mutate the handler.
-    // In fact, this function not accepting a const handler is probably a design
-    // error on the part of Xerces developers.
-    current_node->setUserData( 
-        m_LocationInfoKey,
-        new NodeLocationInfo( line_number, column_number ),
-        const_cast< XercesExt::LocationInfoDataHandler* >( &LOCATION_DATA_HANDLER ) );
-
-    // Attribute nodes get the same location as the opening tag
-    // of the element they were declared in... it's the best we can do.
-    xc::DOMNamedNodeMap *attribute_map = current_node->getAttributes();
-    if ( !attribute_map )
+    if ( !m_LocationTable )
 
         return;
 
-    for ( uint i = 0; i < attribute_map->getLength(); ++i )
-    {
-        attribute_map->item( i )->setUserData( 
-            m_LocationInfoKey,
-            new NodeLocationInfo( line_number, column_number ),
-            const_cast< XercesExt::LocationInfoDataHandler* >( &LOCATION_DATA_HANDLER ) );
-    }
+    const xc::Locator* locator = getScanner()->getLocator();
+
+    // Attributes are looked up through their owner element, so they 
+    // get the location of the opening tag they were declared in... 
+    // it's the best we can do.
+    m_LocationTable->AddLocation( *getCurrentNode(),
+                                  (int) locator->getLineNumber(),
+                                  (int) locator->getColumnNumber() );
 }
 
 }
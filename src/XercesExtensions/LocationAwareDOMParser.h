@@ -32,6 +32,14 @@ namespace xc = XERCES_CPP_NAMESPACE;
 namespace XercesExt
 {
 
+class NodeLocationTable;
+
+/**
+ * A DOM parser that records the line and column number
+ * of every element it creates. The locations are stored in a
+ * NodeLocationTable attached to the document and are 
+ * retrieved with GetNodeLocationInfo().
+ */
 class LocationAwareDOMParser : public xc::XercesDOMParser
 {
 public:
@@ -45,6 +53,23 @@ public:
       */
     ~LocationAwareDOMParser();
 
+    /**
+     * Turns location tracking on or off. It's on by default;
+     * parsers whose documents never get asked for line numbers
+     * should turn it off.
+     *
+     * @param track_locations Whether element locations should be recorded.
+     */
+    void setTrackLocations( bool track_locations );
+
+    bool getTrackLocations() const;
+
+    // override
+    void startDocument();
+
+    // override
+    void endDocument();
+
     // override
     void startElement( const xc::XMLElementDecl &elemDecl,
                        const unsigned int uriId,
@@ -56,6 +81,14 @@ public:
 
 private:
     XMLCh *m_LocationInfoKey;
+
+    bool m_TrackLocations;
+
+    /**
+     * The location table of the document being parsed.
+     * Owned by the document.
+     */
+    NodeLocationTable *m_LocationTable;
 };
 
 }
@@ -20,7 +20,7 @@
 *************************************************************************/
 
 #include "LocationInfoDataHandler.h"
-#include "NodeLocationInfo.h"
+#include "NodeLocationTable.h"
 
 namespace XercesExt
 {
@@ -31,16 +31,16 @@ void LocationInfoDataHandler::handle( DOMOperationType operation,
                                       const xc::DOMNode*,
                                       xc::DOMNode* )
 {
-    NodeLocationInfo* location_info = static_cast< NodeLocationInfo* >( data );
+    NodeLocationTable* location_table = static_cast< NodeLocationTable* >( data );
 
     switch ( operation )
     {
         case NODE_DELETED:
-            delete location_info;
+            delete location_table;
             break;
 
-        // Node deletion is the only thing we care about,
-        // we won't be cloning nodes.
+        // Document deletion is the only thing we care about,
+        // clones don't carry location information.
         default:
             break;
     }
@@ -0,0 +1,82 @@
+/************************************************************************
+**
+**  Copyright (C) 2012  FlightCrew Developers
+**
+**  This file is part of FlightCrew.
+**
+**  FlightCrew is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU Lesser General Public License as published
+**  by the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  FlightCrew is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU Lesser General Public License for more details.
+**
+**  You should have received a copy of the GNU Lesser General Public License
+**  along with FlightCrew.  If not, see <http://www.gnu.org/licenses/>.
+**
+*************************************************************************/
+
+
+#include <algorithm>
+#include "NodeLocationTable.h"
+
+namespace XercesExt
+{
+
+NodeLocationTable::NodeLocationTable()
+    : m_IsSorted( false )
+{
+
+}
+
+
+void NodeLocationTable::AddLocation( const xc::DOMNode &node, int line_number, int column_number )
+{
+    Entry entry;
+    entry.node     = &node;
+    entry.location = NodeLocationInfo( line_number, column_number );
+
+    m_Entries.push_back( entry );
+    m_IsSorted = false;
+}
+
+
+void NodeLocationTable::Finalize()
+{
+    std::sort( m_Entries.begin(), m_Entries.end() );
+    m_IsSorted = true;
+}
+
+
+NodeLocationInfo NodeLocationTable::GetLocation( const xc::DOMNode &node ) const
+{
+    Entry key;
+    key.node = &node;
+
+    if ( m_IsSorted )
+    {
+        std::vector< Entry >::const_iterator it = 
+            std::lower_bound( m_Entries.begin(), m_Entries.end(), key );
+
+        if ( it != m_Entries.end() && it->node == &node )
+
+            return it->location;
+    }
+
+    else
+    {
+        for ( std::vector< Entry >::const_iterator it = m_Entries.begin(); it != m_Entries.end(); ++it )
+        {
+            if ( it->node == &node )
+
+                return it->location;
+        }
+    }
+
+    return NodeLocationInfo();
+}
+
+} // namespace XercesExt
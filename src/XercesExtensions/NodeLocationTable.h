@@ -0,0 +1,92 @@
+/************************************************************************
+**
+**  Copyright (C) 2012  FlightCrew Developers
+**
+**  This file is part of FlightCrew.
+**
+**  FlightCrew is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU Lesser General Public License as published
+**  by the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  FlightCrew is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU Lesser General Public License for more details.
+**
+**  You should have received a copy of the GNU Lesser General Public License
+**  along with FlightCrew.  If not, see <http://www.gnu.org/licenses/>.
+**
+*************************************************************************/
+
+
+#pragma once
+#ifndef NODELOCATIONTABLE_H
+#define NODELOCATIONTABLE_H
+
+#include <vector>
+#include <xercesc/dom/DOMNode.hpp>
+#include "NodeLocationInfo.h"
+
+namespace xc = XERCES_CPP_NAMESPACE;
+
+namespace XercesExt
+{
+
+/**
+ * Stores the locations of all the elements of a parsed document
+ * in a single array, instead of attaching a separately allocated 
+ * NodeLocationInfo to every node. The parser fills the table in 
+ * document order and sorts it once parsing is done.
+ *
+ * The table is keyed by node address, so it only describes the nodes
+ * created by the parser. A node created after a parsed node was
+ * released can reuse its memory, and with it its location.
+ */
+class NodeLocationTable
+{
+public:
+
+    NodeLocationTable();
+
+    void AddLocation( const xc::DOMNode &node, int line_number, int column_number );
+
+    /**
+     * Prepares the table for lookups. Called when parsing is done.
+     */
+    void Finalize();
+
+    /**
+     * Returns the location of the given node. If the node
+     * is not in the table, both numbers in the location are -1.
+     *
+     * @param node The node to look up.
+     * @return The location of the node.
+     */
+    NodeLocationInfo GetLocation( const xc::DOMNode &node ) const;
+
+private:
+
+    struct Entry
+    {
+        const xc::DOMNode *node;
+        NodeLocationInfo location;
+
+        bool operator< ( const Entry &other ) const
+        {
+            return node < other.node;
+        }
+    };
+
+    std::vector< Entry > m_Entries;
+
+    /**
+     * If the parse was aborted, the table was never
+     * sorted and lookups have to use a linear search.
+     */
+    bool m_IsSorted;
+};
+
+} // namespace XercesExt
+
+#endif // NODELOCATIONTABLE_H
@@ -0,0 +1,168 @@
+/************************************************************************
+**
+**  Copyright (C) 2012  FlightCrew Developers
+**
+**  This file is part of FlightCrew.
+**
+**  FlightCrew is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU Lesser General Public License as published
+**  by the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  FlightCrew is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU Lesser General Public License for more details.
+**
+**  You should have received a copy of the GNU Lesser General Public License
+**  along with FlightCrew.  If not, see <http://www.gnu.org/licenses/>.
+**
+*************************************************************************/
+
+
+#pragma once
+#ifndef PARSERPOOL_H
+#define PARSERPOOL_H
+
+#include <vector>
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+#include <xercesc/parsers/XercesDOMParser.hpp>
+#include <xercesc/sax2/SAX2XMLReader.hpp>
+#include "GrammarPool.h"
+
+namespace xc = XERCES_CPP_NAMESPACE;
+
+namespace XercesExt
+{
+
+/**
+ * Prepares a DOM parser for its next user.
+ * Releases the documents that weren't adopted.
+ */
+inline void ResetParserForReuse( xc::XercesDOMParser &parser )
+{
+    parser.setErrorHandler( 0 );
+    parser.resetDocumentPool();
+}
+
+/**
+ * Prepares a SAX2 reader for its next user.
+ */
+inline void ResetParserForReuse( xc::SAX2XMLReader &reader )
+{
+    reader.setErrorHandler( 0 );
+    reader.setContentHandler( 0 );
+}
+
+
+/**
+ * A set of reusable, identically configured parsers that all use 
+ * the same locked grammar pool. Every thread that is parsing at the 
+ * same time gets its own parser; the parsers are handed back to the
+ * pool once the caller is done with them, so a parser is only created
+ * when all existing ones are busy.
+ */
+template< class Parser >
+class ParserPool : private boost::noncopyable
+{
+public:
+
+    /**
+     * Creates and configures a new parser that uses the given grammar pool.
+     */
+    typedef boost::function< Parser* ( xc::XMLGrammarPool& ) > ParserCreator;
+
+    /**
+     * Constructor. 
+     *
+     * @param dtds The DTDs to load into the grammar pool.
+     * @param schemas The XML schemas to load into the grammar pool.
+     * @param creator The function used to create new parsers.
+     */
+    ParserPool( const std::vector< const xc::InputSource* > &dtds,
+                const std::vector< const xc::InputSource* > &schemas,
+                const ParserCreator &creator )
+        :
+        m_GrammarPool( dtds, schemas ),
+        m_Creator( creator )
+    {
+
+    }
+
+    /**
+     * Destructor. All the parsers must have been returned by now.
+     */
+    ~ParserPool()
+    {
+        for ( typename std::vector< Parser* >::iterator it = m_IdleParsers.begin(); 
+              it != m_IdleParsers.end(); 
+              ++it )
+        {
+            delete *it;
+        }
+    }
+
+    /**
+     * Returns a parser for the exclusive use of the caller. The parser
+     * is returned to the pool when the last copy of the pointer is gone,
+     * so it shouldn't be kept around longer than needed.
+     *
+     * @return The parser.
+     */
+    boost::shared_ptr< Parser > GetParser()
+    {
+        Parser *parser = 0;
+
+        {
+            boost::lock_guard< boost::mutex > locker( m_IdleParsersMutex );
+
+            if ( !m_IdleParsers.empty() )
+            {
+                parser = m_IdleParsers.back();
+                m_IdleParsers.pop_back();
+            }
+        }
+
+        if ( !parser )
+
+            parser = m_Creator( m_GrammarPool.GetPool() );
+
+        return boost::shared_ptr< Parser >( parser, boost::bind( &ParserPool::ReturnParser, this, _1 ) );
+    }
+
+private:
+
+    void ReturnParser( Parser *parser )
+    {
+        ResetParserForReuse( *parser );
+
+        boost::lock_guard< boost::mutex > locker( m_IdleParsersMutex );
+        m_IdleParsers.push_back( parser );
+    }
+
+
+    ///////////////////////////////
+    // PRIVATE MEMBER VARIABLES
+    ///////////////////////////////
+
+    /**
+     * The grammars shared by all the parsers.
+     * Needs to outlive the parsers.
+     */
+    GrammarPool m_GrammarPool;
+
+    ParserCreator m_Creator;
+
+    std::vector< Parser* > m_IdleParsers;
+
+    boost::mutex m_IdleParsersMutex;
+};
+
+} // namespace XercesExt
+
+#endif // PARSERPOOL_H
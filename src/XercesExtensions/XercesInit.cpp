@@ -20,21 +20,56 @@
 *************************************************************************/
 
 #include "XercesInit.h"
+#include <boost/thread/locks.hpp>
 #include <xercesc/util/PlatformUtils.hpp>
 namespace xc = XERCES_CPP_NAMESPACE;
 
 namespace XercesExt
 {
 
+boost::mutex XercesInit::s_AccessMutex;
+int XercesInit::s_InitCount = 0;
+std::vector< boost::function< void() > > XercesInit::s_TerminationHandlers;
+
 XercesInit::XercesInit()
 {
+    boost::lock_guard< boost::mutex > locker( s_AccessMutex );
+
     xc::XMLPlatformUtils::Initialize();
+    ++s_InitCount;
 }
 
 
 XercesInit::~XercesInit()
 {
+    std::vector< boost::function< void() > > handlers;
+
+    {
+        boost::lock_guard< boost::mutex > locker( s_AccessMutex );
+
+        if ( --s_InitCount == 0 )
+
+            handlers.swap( s_TerminationHandlers );
+    }
+
+    // The handlers are run without holding the lock 
+    // since they usually need to take locks of their own.
+    for ( std::vector< boost::function< void() > >::reverse_iterator it = handlers.rbegin();
+          it != handlers.rend();
+          ++it )
+    {
+        (*it)();
+    }
+
     xc::XMLPlatformUtils::Terminate();
 }
 
+
+void XercesInit::AddTerminationHandler( const boost::function< void() > &handler )
+{
+    boost::lock_guard< boost::mutex > locker( s_AccessMutex );
+
+    s_TerminationHandlers.push_back( handler );
+}
+
 } // namespace XercesExt
\ No newline at end of file
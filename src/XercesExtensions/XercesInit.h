@@ -23,6 +23,10 @@
 #ifndef XERCESINIT_H
 #define XERCESINIT_H
 
+#include <vector>
+#include <boost/function.hpp>
+#include <boost/thread/mutex.hpp>
+
 namespace XercesExt
 {
 
@@ -31,6 +35,25 @@ class XercesInit
 public:
     XercesInit();
     ~XercesInit();
+
+    /**
+     * Registers a function that is called right before Xerces 
+     * is terminated by the last live XercesInit object. Anything that 
+     * holds on to Xerces objects beyond the lifetime of a single XercesInit
+     * (like cached parsers) needs to release them from such a function.
+     * The functions are called in the reverse order of registration.
+     *
+     * @param handler The function to call.
+     */
+    static void AddTerminationHandler( const boost::function< void() > &handler );
+
+private:
+
+    static boost::mutex s_AccessMutex;
+
+    static int s_InitCount;
+
+    static std::vector< boost::function< void() > > s_TerminationHandlers;
 };
 
 
@@ -0,0 +1,106 @@
+/************************************************************************
+**
+**  Copyright (C) 2012  FlightCrew Developers
+**
+**  This file is part of FlightCrew.
+**
+**  FlightCrew is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU Lesser General Public License as published
+**  by the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  FlightCrew is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU Lesser General Public License for more details.
+**
+**  You should have received a copy of the GNU Lesser General Public License
+**  along with FlightCrew.  If not, see <http://www.gnu.org/licenses/>.
+**
+*************************************************************************/
+
+
+#pragma once
+#ifndef XERCESSTATIC_H
+#define XERCESSTATIC_H
+
+#include <boost/bind.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+#include "XercesInit.h"
+
+namespace XercesExt
+{
+
+/**
+ * A process-wide object that holds Xerces objects. 
+ * It's created on first use and destroyed right before
+ * Xerces is terminated, since destroying it afterwards
+ * (with the rest of the static objects) would crash.
+ * If Xerces is initialized again, so is the object.
+ */
+template< class T >
+class XercesStatic : private boost::noncopyable
+{
+public:
+
+    typedef T* (*Creator)();
+
+    /**
+     * Constructor.
+     *
+     * @param creator The function used to create the object.
+     */
+    explicit XercesStatic( Creator creator )
+        :
+        m_Creator( creator ),
+        m_Instance( 0 )
+    {
+
+    }
+
+    /**
+     * Returns the object, creating it if needed.
+     * Must only be called while Xerces is initialized.
+     *
+     * @return The object.
+     */
+    T& Get()
+    {
+        boost::lock_guard< boost::mutex > locker( m_AccessMutex );
+
+        if ( !m_Instance )
+        {
+            m_Instance = m_Creator();
+            XercesInit::AddTerminationHandler( boost::bind( &XercesStatic::Destroy, this ) );
+        }
+
+        return *m_Instance;
+    }
+
+private:
+
+    void Destroy()
+    {
+        boost::lock_guard< boost::mutex > locker( m_AccessMutex );
+
+        delete m_Instance;
+        m_Instance = 0;
+    }
+
+
+    ///////////////////////////////
+    // PRIVATE MEMBER VARIABLES
+    ///////////////////////////////
+
+    Creator m_Creator;
+
+    T *m_Instance;
+
+    boost::mutex m_AccessMutex;
+};
+
+} // namespace XercesExt
+
+#endif // XERCESSTATIC_H
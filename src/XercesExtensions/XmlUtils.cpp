@@ -22,6 +22,7 @@
 #include "XmlUtils.h"
 #include "ToXercesStringConverter.h"
 #include "FromXercesStringConverter.h"
+#include "NodeLocationTable.h"
 #include <xercesc/dom/DOMElement.hpp>
 #include <xercesc/dom/DOMAttr.hpp>
 #include <xercesc/dom/DOMDocument.hpp>
@@ -39,12 +40,21 @@ namespace XercesExt
 
 NodeLocationInfo GetNodeLocationInfo( const xc::DOMNode &node )
 {
-    NodeLocationInfo *location = static_cast< NodeLocationInfo* >(
-        node.getUserData( toX( LOCATION_INFO_KEY ) ) );
+    // Attributes share the location of their element
+    const xc::DOMNode *element = node.getNodeType() == xc::DOMNode::ATTRIBUTE_NODE ?
+                                 static_cast< const xc::DOMAttr& >( node ).getOwnerElement() :
+                                 &node;
 
-    if ( location )
+    if ( !element || !element->getOwnerDocument() )
 
-        return *location;
+        return NodeLocationInfo();
+
+    NodeLocationTable *location_table = static_cast< NodeLocationTable* >(
+        element->getOwnerDocument()->getUserData( toX( LOCATION_INFO_KEY ) ) );
+
+    if ( location_table )
+
+        return location_table->GetLocation( *element );
     
     return NodeLocationInfo();
 }
@@ -1171,6 +1171,18 @@ int         TY_(DocParseStream)( TidyDocImpl* doc, StreamIn* in )
     TY_(FreeNode)(doc, &doc->root);
     TidyClearMemory(&doc->root, sizeof(Node));
 
+    /* Hack added by Sigil: reset the per-document results so that
+       a TidyDoc can be reused for parsing several documents */
+    doc->errors = 0;
+    doc->warnings = 0;
+    doc->accessErrors = 0;
+    doc->infoMessages = 0;
+    doc->docErrors = 0;
+    doc->badAccess = 0;
+    doc->badLayout = 0;
+    doc->badChars = 0;
+    doc->badForm = 0;
+
     if (doc->givenDoctype)
         TidyDocFree(doc, doc->givenDoctype);
 